@@ -0,0 +1,187 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+
+
+#if defined(__SANITIZE_ADDRESS__)
+#define SLMEM_ASAN_ENABLED
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SLMEM_ASAN_ENABLED
+#endif // #if __has_feature(address_sanitizer)
+#endif // #if defined(__SANITIZE_ADDRESS__)
+
+#if defined(SLMEM_ASAN_ENABLED)
+#include <sanitizer/asan_interface.h>
+#define SLMEM_ASAN_POISON(addr, size)	ASAN_POISON_MEMORY_REGION(addr, size)
+#define SLMEM_ASAN_UNPOISON(addr, size)	ASAN_UNPOISON_MEMORY_REGION(addr, size)
+#else
+#define SLMEM_ASAN_POISON(addr, size)	((void)(addr), (void)(size))
+#define SLMEM_ASAN_UNPOISON(addr, size)	((void)(addr), (void)(size))
+#endif // #if defined(SLMEM_ASAN_ENABLED)
+
+#define SLMEM_HARDENING_POISON_BYTE		0xDD
+#define SLMEM_HARDENING_FREE_CANARY		uintptr_t(0x5EEDF4EE5EEDF4EEull)
+#define SLMEM_HARDENING_GUARD_CANARY	uintptr_t(0x6A4DB17E6A4DB17Eull)
+
+class AbortOnCorruptionHandler {
+public:
+	static void OnCorruption(const char *what, const void *addr) {
+		fprintf(stderr, "slmem: heap corruption detected: %s (%p)\n", what, addr);
+		abort();
+	}
+};
+
+// Corruption detection cheap enough to be left on in production builds:
+// - freelist links are mangled with the slot address and a per-process cookie, a wild link is caught before being followed
+// - returned slots get a canary word right after the allocator metadata, checked (then cleared) on Get, it also
+//   catches returning the same element twice
+// - the rest of a returned slot is filled with SLMEM_HARDENING_POISON_BYTE
+// - linear allocations are followed by a guard (canary + size) checked on LinearAllocator::Reset/CheckGuards
+// - freed slots and guards are poisoned for ASan when built with the sanitizer
+// Slots too small to hold a canary after the allocator metadata only get link mangling and poisoning.
+template<typename CorruptionHandler = AbortOnCorruptionHandler>
+class DefaultHardeningPolicy {
+public:
+	static constexpr bool Enabled = true;
+	static constexpr size_t LinearGuardSize = 2 * sizeof(uintptr_t);
+
+	static void *EncodeLink(void *link, const void *slot) {
+		return reinterpret_cast<void*>(uintptr_t(link) ^ (uintptr_t(slot) >> 12) ^ cookie());
+	}
+
+	static void *DecodeLink(void *link, const void *slot) {
+		return EncodeLink(link, slot);
+	}
+
+	static bool IsFreed(const void *slot, size_t size, size_t reservedSize) {
+		if (size < reservedSize + sizeof(uintptr_t))
+			return false;
+
+		return readWord(static_cast<const unsigned char*>(slot) + reservedSize) == freeCanary(slot);
+	}
+
+	static void OnFree(void *slot, size_t size, size_t reservedSize) {
+		unsigned char *bytes = static_cast<unsigned char*>(slot);
+
+		size_t metadataSize = reservedSize;
+		if (size >= reservedSize + sizeof(uintptr_t)) {
+			writeWord(bytes + reservedSize, freeCanary(slot));
+			metadataSize += sizeof(uintptr_t);
+		}
+
+		memset(bytes + metadataSize, SLMEM_HARDENING_POISON_BYTE, size - metadataSize);
+		SLMEM_ASAN_POISON(bytes + metadataSize, size - metadataSize);
+	}
+
+	static bool OnAlloc(void *slot, size_t size, size_t reservedSize) {
+		unsigned char *bytes = static_cast<unsigned char*>(slot);
+		SLMEM_ASAN_UNPOISON(bytes, size);
+
+		if (size < reservedSize + sizeof(uintptr_t))
+			return true;
+
+		if (readWord(bytes + reservedSize) != freeCanary(slot)) {
+			OnCorruption("Element modified after being returned.", slot);
+			return false;
+		}
+
+		writeWord(bytes + reservedSize, 0);
+		return true;
+	}
+
+	// Slot handed out without going through the freelist: never returned since it was last committed, or dropped from
+	// the freelist by Reclaim while its page stayed committed. Its canary isn't checked, only cleared as it may be stale.
+	static void OnAllocClean(void *slot, size_t size, size_t reservedSize) {
+		unsigned char *bytes = static_cast<unsigned char*>(slot);
+		SLMEM_ASAN_UNPOISON(bytes, size);
+
+		if (size >= reservedSize + sizeof(uintptr_t))
+			writeWord(bytes + reservedSize, 0);
+	}
+
+	// Poisons the alignment padding after the allocation and writes the guard right after it
+	static void WriteLinearGuard(void *addr, size_t size, size_t alignedSize) {
+		unsigned char *bytes = static_cast<unsigned char*>(addr);
+		SLMEM_ASAN_UNPOISON(bytes, alignedSize + LinearGuardSize);
+
+		memset(bytes + size, SLMEM_HARDENING_POISON_BYTE, alignedSize - size);
+
+		unsigned char *guard = bytes + alignedSize;
+		writeWord(guard, guardCanary(guard, size));
+		writeWord(guard + sizeof(uintptr_t), size);
+
+		SLMEM_ASAN_POISON(bytes + size, alignedSize - size + LinearGuardSize);
+	}
+
+	static bool CheckLinearGuard(const void *guard, size_t alignment, size_t &alignedSize) {
+		const unsigned char *bytes = static_cast<const unsigned char*>(guard);
+		SLMEM_ASAN_UNPOISON(bytes, LinearGuardSize);
+
+		const uintptr_t canary = readWord(bytes);
+		const size_t size = readWord(bytes + sizeof(uintptr_t));
+
+		SLMEM_ASAN_POISON(bytes, LinearGuardSize);
+
+		if (canary != guardCanary(guard, size))
+			return false;
+
+		alignedSize = (size + alignment - 1) & ~(alignment - 1);
+
+		const unsigned char *padding = bytes - (alignedSize - size);
+		SLMEM_ASAN_UNPOISON(padding, alignedSize - size);
+
+		bool paddingIntact = true;
+		for (size_t i = 0; i < alignedSize - size; i++) {
+			paddingIntact &= padding[i] == SLMEM_HARDENING_POISON_BYTE;
+		}
+
+		SLMEM_ASAN_POISON(padding, alignedSize - size);
+
+		return paddingIntact;
+	}
+
+	static void OnCorruption(const char *what, const void *addr) {
+		CorruptionHandler::OnCorruption(what, addr);
+	}
+
+private:
+	// Derived from the code and stack addresses, so it changes with ASLR on every run
+	static uintptr_t cookie() {
+		static const uintptr_t value = initCookie();
+		return value;
+	}
+
+	static uintptr_t initCookie() {
+		uint64_t seed = uint64_t(uintptr_t(&initCookie)) ^ (uint64_t(uintptr_t(&seed)) << 16);
+
+		// splitmix64 finalizer
+		seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+		seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+		return uintptr_t(seed ^ (seed >> 31));
+	}
+
+	static uintptr_t freeCanary(const void *slot) {
+		return uintptr_t(slot) ^ cookie() ^ SLMEM_HARDENING_FREE_CANARY;
+	}
+
+	static uintptr_t guardCanary(const void *guard, size_t size) {
+		return uintptr_t(guard) ^ cookie() ^ SLMEM_HARDENING_GUARD_CANARY ^ (uintptr_t(size) * 0x9E3779B1u);
+	}
+
+	// Slots and guards are not necessarily aligned on a word
+	static uintptr_t readWord(const void *addr) {
+		uintptr_t word;
+		memcpy(&word, addr, sizeof(word));
+		return word;
+	}
+
+	static void writeWord(void *addr, uintptr_t word) {
+		memcpy(addr, &word, sizeof(word));
+	}
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "mem_map.h"
+
+
+// Reclaims the idle memory of an allocator once it went through no Get/Return/Alloc/Reset for idleThreshold.
+// Time is whatever monotonic unit the caller uses for both idleThreshold and Update.
+template<typename AllocatorType, typename DecommitPolicy = VirtualMemory>
+class IdleReclaimer {
+public:
+	IdleReclaimer(AllocatorType &allocator, uint64_t idleThreshold)
+		: allocator(allocator)
+		, idleThreshold(idleThreshold) {
+	}
+
+	// Returns the bytes given back to the OS by this update
+	size_t Update(uint64_t now) {
+		const size_t activity = allocator.GetActivity();
+		if (activity != lastActivity || !started) {
+			started = true;
+			lastActivity = activity;
+			lastChange = now;
+			reclaimed = false;
+			return 0;
+		}
+
+		if (reclaimed || now - lastChange < idleThreshold)
+			return 0;
+
+		reclaimed = true;
+
+		const size_t releasedSize = allocator.template Reclaim<DecommitPolicy>();
+		totalReleasedSize += releasedSize;
+
+		return releasedSize;
+	}
+
+	size_t GetReleasedSize() const {
+		return totalReleasedSize;
+	}
+
+private:
+	AllocatorType &allocator;
+	uint64_t idleThreshold = 0;
+	uint64_t lastChange = 0;
+	size_t lastActivity = 0;
+	size_t totalReleasedSize = 0;
+	bool started = false;
+	bool reclaimed = false;
+};
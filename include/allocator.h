@@ -3,9 +3,12 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <atomic>
+#include <memory>
 #include <new>
+#include <utility>
 
 
 #define SL_STRINGIFY_MACRO(x)	#x
@@ -14,6 +17,16 @@
 
 #define SLMEM_NOALLOC_TAG_POLICY_INVALID_ID	"NULL"
 
+#define SLMEM_CACHE_LINE_SIZE	64
+
+// Tags the allocation made by Emplace/EmplaceArray/MakeUnique/MakePoolPtr when passed ahead of the constructor args,
+// e.g. pool.Emplace(AllocId(SL_CURRENT_FILE_LINENUM), args...), the same way allocId does for Get/Alloc
+struct AllocId {
+	explicit AllocId(const char *id) : id(id) {}
+
+	const char *id;
+};
+
 class NoAllocTagPolicy {
 public:
 	static void Tag(const void * /*addr*/, const char * /*id*/, size_t /*size*/) { }
@@ -31,6 +44,124 @@ public:
 	static void OnAlloc(const void * /*addr*/, size_t /*size*/) {}
 };
 
+// Allocators only call the hardening policy behind HardeningPolicy::Enabled, so all checks compile away with this one
+class NoHardeningPolicy {
+public:
+	static constexpr bool Enabled = false;
+	static constexpr size_t LinearGuardSize = 0;
+
+	static void *EncodeLink(void *link, const void * /*slot*/) { return link; }
+	static void *DecodeLink(void *link, const void * /*slot*/) { return link; }
+	static bool IsFreed(const void * /*slot*/, size_t /*size*/, size_t /*reservedSize*/) { return false; }
+	static void OnFree(void * /*slot*/, size_t /*size*/, size_t /*reservedSize*/) {}
+	static bool OnAlloc(void * /*slot*/, size_t /*size*/, size_t /*reservedSize*/) { return true; }
+	static void OnAllocClean(void * /*slot*/, size_t /*size*/, size_t /*reservedSize*/) {}
+	static void WriteLinearGuard(void * /*addr*/, size_t /*size*/, size_t /*alignedSize*/) {}
+	static bool CheckLinearGuard(const void * /*guard*/, size_t /*alignment*/, size_t & /*alignedSize*/) { return true; }
+	static void OnCorruption(const char * /*what*/, const void * /*addr*/) {}
+};
+
+// unique_ptr deleter returning (and destroying) the element to a pool with static storage duration, the pool is bound
+// at compile time so the deleter is stateless and a PoolPtr is the size of a raw pointer
+template<typename PoolType, PoolType &Pool>
+struct PoolDeleter {
+	void operator()(typename PoolType::ElementType *elem) const {
+		Pool.template Return<true>(elem);
+	}
+};
+
+template<typename PoolType, PoolType &Pool>
+using PoolPtr = std::unique_ptr<typename PoolType::ElementType, PoolDeleter<PoolType, Pool>>;
+
+// args may start with an AllocId, see Emplace
+template<typename PoolType, PoolType &Pool, typename... Args>
+PoolPtr<PoolType, Pool> MakePoolPtr(Args &&... args) {
+	return PoolPtr<PoolType, Pool>(Pool.Emplace(std::forward<Args>(args)...));
+}
+
+// Same as PoolDeleter for pools without static storage duration, holds a pointer to the pool
+template<typename PoolType>
+struct PoolInstanceDeleter {
+	PoolType *pool;
+
+	void operator()(typename PoolType::ElementType *elem) const {
+		pool->template Return<true>(elem);
+	}
+};
+
+// Get<true> default construction, only instantiated when requested so pools of types without a default constructor can be used with Emplace
+template<bool ShouldConstruct>
+struct PoolElemConstructor {
+	template<typename T>
+	static void Construct(T * /*elem*/) {}
+};
+
+template<>
+struct PoolElemConstructor<true> {
+	template<typename T>
+	static void Construct(T *elem) {
+		new (elem) T;
+	}
+};
+
+// Returns the element to the pool if its construction throws
+template<typename PoolType>
+struct PoolReturnGuard {
+	PoolType &pool;
+	typename PoolType::ElementType *elem;
+
+	~PoolReturnGuard() {
+		if (elem)
+			pool.Return(elem);
+	}
+};
+
+// Destroys the elements already constructed if the construction of an array throws
+template<typename T>
+struct ArrayDestroyGuard {
+	T *elems;
+	size_t count;
+
+	~ArrayDestroyGuard() {
+		while (count)
+			elems[--count].~T();
+	}
+};
+
+// Tracks the pool slots whose page was released by Reclaim, as they lost their hardening canary.
+// Empty when hardening is disabled, pools derive from it so it takes no room then.
+template<bool Enabled, size_t WordCount>
+class PoolReleasedSlots {
+protected:
+	void ClearReleased() {}
+	void MarkReleased(size_t /*poolIndex*/) {}
+	bool TakeReleased(size_t /*poolIndex*/) { return false; }
+};
+
+template<size_t WordCount>
+class PoolReleasedSlots<true, WordCount> {
+protected:
+	void ClearReleased() {
+		memset(releasedSlots, 0, sizeof(releasedSlots));
+	}
+
+	void MarkReleased(size_t poolIndex) {
+		releasedSlots[poolIndex >> 5] |= (1u << (poolIndex % 32));
+	}
+
+	// Returns whether the slot was released and clears its flag
+	bool TakeReleased(size_t poolIndex) {
+		const uint32_t mask = 1u << (poolIndex % 32);
+		const bool released = (releasedSlots[poolIndex >> 5] & mask) != 0;
+		releasedSlots[poolIndex >> 5] &= ~mask;
+
+		return released;
+	}
+
+private:
+	uint32_t releasedSlots[WordCount];
+};
+
 template <typename T>
 class AllocatorTraits {
 public:
@@ -56,30 +187,51 @@ public:
 };
 
 // TODO enforce LeakDetectPolicy to always be NoLeakDetectPolicy as there's no real freeing of allocations in a LinearAllocator
-template<size_t Alignment = 4, typename AllocTagPolicy = NoAllocTagPolicy, typename LeakDetectPolicy = NoLeakDetectPolicy, typename FallbackPolicy = NoFallbackPolicy>
+template<size_t Alignment = 4, typename AllocTagPolicy = NoAllocTagPolicy, typename LeakDetectPolicy = NoLeakDetectPolicy, typename FallbackPolicy = NoFallbackPolicy, typename HardeningPolicy = NoHardeningPolicy>
 class LinearAllocator {
 public:
 	LinearAllocator(void *preAllocatedData, size_t size)
 		: data(preAllocatedData)
 		, currentPtr(static_cast<unsigned char*>(data))
+		, highWaterPtr(currentPtr)
 		, dataSize(size) {
 	}
 
+	LinearAllocator() {
+	}
+
 	~LinearAllocator() {
 	}
 
+	void SetData(void *preAllocatedData, size_t size) {
+		data = preAllocatedData;
+		currentPtr = static_cast<unsigned char*>(data);
+		highWaterPtr = currentPtr;
+		dataSize = size;
+		count = 0;
+	}
+
+	bool HasData() const {
+		return data != nullptr;
+	}
+
 	void *Alloc(size_t size, const char *allocId = SLMEM_NOALLOC_TAG_POLICY_INVALID_ID) {
 		assert(data && "Allocator preallocated data not set.");
 
+		activity++;
+
 		// TODO add a SLMISC_ALIGNUP or something like that and use it here
 		const size_t alignedSize = (size + Alignment - 1) & ~(Alignment - 1);
 
 		void *ret = nullptr;
-		if (currentPtr + alignedSize <= static_cast<unsigned char*>(data) + dataSize) {
+		if (currentPtr + alignedSize + GuardAllocSize <= static_cast<unsigned char*>(data) + dataSize) {
 			ret = currentPtr;
-			currentPtr += alignedSize;
+			currentPtr += alignedSize + GuardAllocSize;
 			count++;
 
+			if (HardeningPolicy::Enabled)
+				HardeningPolicy::WriteLinearGuard(ret, size, alignedSize);
+
 			AllocTagPolicy::Tag(ret, allocId, alignedSize);
 			LeakDetectPolicy::Assign(ret, alignedSize);
 		}
@@ -90,27 +242,128 @@ public:
 		return ret;
 	}
 
+	// Constructs a T in place, destructors are never run by the allocator (Reset just rewinds)
+	template<typename T, typename... Args>
+	T *Emplace(AllocId allocId, Args &&... args) {
+		static_assert(alignof(T) <= Alignment, "Type alignment is greater than the allocator alignment.");
+
+		void *ret = Alloc(sizeof(T), allocId.id);
+		return ret ? new (ret) T(std::forward<Args>(args)...) : nullptr;
+	}
+
+	template<typename T, typename... Args>
+	T *Emplace(Args &&... args) {
+		return Emplace<T>(AllocId(SLMEM_NOALLOC_TAG_POLICY_INVALID_ID), std::forward<Args>(args)...);
+	}
+
+	// Constructs count contiguous Ts, each one from the same args, returns nullptr when they don't fit
+	template<typename T, typename... Args>
+	T *EmplaceArray(AllocId allocId, size_t count, const Args &... args) {
+		static_assert(alignof(T) <= Alignment, "Type alignment is greater than the allocator alignment.");
+
+		if (count > SIZE_MAX / sizeof(T))
+			return nullptr;
+
+		T *ret = static_cast<T*>(Alloc(sizeof(T) * count, allocId.id));
+		if (!ret)
+			return nullptr;
+
+		ArrayDestroyGuard<T> guard{ ret, 0 };
+		for (; guard.count < count; guard.count++) {
+			new (&ret[guard.count]) T(args...);
+		}
+		guard.count = 0;
+
+		return ret;
+	}
+
+	template<typename T, typename... Args>
+	T *EmplaceArray(size_t count, const Args &... args) {
+		return EmplaceArray<T>(AllocId(SLMEM_NOALLOC_TAG_POLICY_INVALID_ID), count, args...);
+	}
+
 	void Free(void *addr) {}
 
 	void Reset() {
-		currentPtr = data;
+		CheckGuards();
+
+		activity++;
+
+		if (currentPtr > highWaterPtr)
+			highWaterPtr = currentPtr;
+
+		currentPtr = static_cast<unsigned char*>(data);
 		count = 0;
 	}
 
+	// Releases the pages above the current allocation point that were used since the last Reclaim, typically after a Reset.
+	// The pre-allocated data must be anonymous memory (see VirtualMemory::Decommit), the content of released pages is unspecified.
+	// DecommitPolicy provides the static PageSize/DecommitRange calls, e.g. VirtualMemory from mem_map.h.
+	template<typename DecommitPolicy>
+	size_t Reclaim() {
+		assert(data && "Allocator preallocated data not set.");
+
+		unsigned char *end = highWaterPtr > currentPtr ? highWaterPtr : currentPtr;
+		const uintptr_t pageMask = DecommitPolicy::PageSize() - 1;
+		const uintptr_t dataEnd = uintptr_t(data) + dataSize;
+
+		// the page holding the high water mark is entirely ours unless it's past the end of the data
+		uintptr_t releaseEnd = (uintptr_t(end) + pageMask) & ~pageMask;
+		if (releaseEnd > dataEnd)
+			releaseEnd = dataEnd;
+
+		highWaterPtr = currentPtr;
+
+		return DecommitPolicy::DecommitRange(currentPtr, reinterpret_cast<void*>(releaseEnd));
+	}
+
+	// Walks the allocations backward from the last one through their guards, reporting the first overwritten one
+	bool CheckGuards() {
+		if (!HardeningPolicy::Enabled)
+			return true;
+
+		const unsigned char *begin = static_cast<unsigned char*>(data);
+		const unsigned char *end = currentPtr;
+		while (end > begin) {
+			const unsigned char *guard = end - GuardAllocSize;
+			size_t alignedSize = 0;
+			if (guard < begin || !HardeningPolicy::CheckLinearGuard(guard, Alignment, alignedSize) || size_t(guard - begin) < alignedSize) {
+				HardeningPolicy::OnCorruption("Linear allocation guard overwritten.", guard);
+				return false;
+			}
+
+			end = guard - alignedSize;
+		}
+
+		return true;
+	}
+
 	size_t GetCount() {
 		return count;
 	}
 
+	// Number of Alloc/Reset calls so far, tells whether the allocator was used between two points in time
+	size_t GetActivity() const {
+		return activity;
+	}
+
 private:
+	static constexpr size_t GuardAllocSize = (HardeningPolicy::LinearGuardSize + Alignment - 1) & ~(Alignment - 1);
+
 	void *data = nullptr;
 	unsigned char *currentPtr = nullptr;
+	unsigned char *highWaterPtr = nullptr;
 	size_t dataSize = 0;
 	size_t count = 0;
+	size_t activity = 0;
 };
 
-template<typename ElemType, size_t Capacity, typename AllocTagPolicy = NoAllocTagPolicy, typename LeakDetectPolicy = NoLeakDetectPolicy, typename FallbackPolicy = NoFallbackPolicy>
-class PoolAllocatorBitArray {
+template<typename ElemType, size_t Capacity, typename AllocTagPolicy = NoAllocTagPolicy, typename LeakDetectPolicy = NoLeakDetectPolicy, typename FallbackPolicy = NoFallbackPolicy, typename HardeningPolicy = NoHardeningPolicy>
+class PoolAllocatorBitArray : private PoolReleasedSlots<HardeningPolicy::Enabled, (Capacity + 31) / 32> {
 public:
+	typedef ElemType ElementType;
+	typedef std::unique_ptr<ElemType, PoolInstanceDeleter<PoolAllocatorBitArray>> UniquePtr;
+
 	PoolAllocatorBitArray(void *preAllocatedData, size_t size) :
 		dataAsVoid(preAllocatedData),
 		freeElem(dataAsElemType) {
@@ -121,6 +374,7 @@ public:
 	PoolAllocatorBitArray() :
 		dataAsVoid(nullptr) {
 		memset(elemsUsage, 0, sizeof(elemsUsage));
+		this->ClearReleased();
 	}
 
 	~PoolAllocatorBitArray() {
@@ -133,6 +387,13 @@ public:
 		freeElem = dataAsElemType;
 
 		memset(elemsUsage, 0, sizeof(elemsUsage));
+		this->ClearReleased();
+
+		if (HardeningPolicy::Enabled) {
+			for (size_t i = 0; i < Capacity; i++) {
+				HardeningPolicy::OnFree(&dataAsElemType[i], sizeof(ElemType), 0);
+			}
+		}
 	}
 
 	bool HasData() const {
@@ -145,6 +406,8 @@ public:
 	ElemType *Get(const char *allocId = SLMEM_NOALLOC_TAG_POLICY_INVALID_ID) {
 		assert(dataAsVoid && "Preallocated data not set.");
 
+		activity++;
+
 		if (count == Capacity) {
 			FallbackPolicy::OnAlloc(nullptr, sizeof(ElemType));
 			return nullptr;
@@ -170,23 +433,28 @@ public:
 		// try to set freeElem to the next element
 		freeElem = nullptr;
 		if (count < Capacity) {
-			if (freeBit < 31) {
-				const int nextBit = (freeBit + 1) % Capacity;
-				freeElem = isFree(freeIdx, nextBit) ? &dataAsElemType[poolIndexFromUsageIndexAndBit(freeIdx, nextBit)] : nullptr;
-			}
-			else {
-				freeElem = isFree(freeIdx + 1, 0) ? &dataAsElemType[poolIndexFromUsageIndexAndBit(freeIdx + 1, 0)] : nullptr;
-			}
+			const size_t nextIndex = poolIndexFromUsageIndexAndBit(freeIdx, freeBit) + 1;
+			if (nextIndex < Capacity && isFree(int(nextIndex >> 5), int(nextIndex % 32)))
+				freeElem = &dataAsElemType[nextIndex];
 		}
 
 		ElemType *ret = &dataAsElemType[poolIndexFromUsageIndexAndBit(freeIdx, freeBit)];
 		assert(ret >= dataAsElemType && ret < dataAsElemType + Capacity);
 
+		if (HardeningPolicy::Enabled) {
+			// a released slot lost its canary with its page
+			if (this->TakeReleased(poolIndexFromUsageIndexAndBit(freeIdx, freeBit))) {
+				HardeningPolicy::OnAllocClean(ret, sizeof(ElemType), 0);
+			}
+			else {
+				HardeningPolicy::OnAlloc(ret, sizeof(ElemType), 0);
+			}
+		}
+
 		AllocTagPolicy::Tag(ret, allocId, sizeof(ElemType));
 		LeakDetectPolicy::Assign(ret, sizeof(ElemType));
 
-		if (ShouldConstruct)
-			new (ret) ElemType;
+		PoolElemConstructor<ShouldConstruct>::Construct(ret);
 
 		return ret;
 	}
@@ -195,10 +463,17 @@ public:
 	void Return(ElemType *elem) {
 		assert((elem >= dataAsElemType && elem < dataAsElemType + Capacity) && "The element is not within this pool range.");
 
+		activity++;
+
 		const size_t poolIndex = elem - dataAsElemType;
 		const int index = poolIndex >> 5;
 		const int bit = poolIndex % 32;
 
+		if (HardeningPolicy::Enabled && isFree(index, bit)) {
+			HardeningPolicy::OnCorruption("Element already returned.", elem);
+			return;
+		}
+
 		assert((elemsUsage[index] & (1 << bit)) && "Element already freed.");
 		elemsUsage[index] &= ~(1 << bit);
 
@@ -214,18 +489,105 @@ public:
 		if (ShouldDestroy)
 			ret->~ElemType();
 
+		if (HardeningPolicy::Enabled)
+			HardeningPolicy::OnFree(ret, sizeof(ElemType), 0);
+	}
+
+	// Constructs the element in place from args, returns nullptr when the pool is full
+	template<typename... Args>
+	ElemType *Emplace(AllocId allocId, Args &&... args) {
+		PoolReturnGuard<PoolAllocatorBitArray> guard{ *this, Get(allocId.id) };
+		if (!guard.elem)
+			return nullptr;
+
+		ElemType *ret = new (guard.elem) ElemType(std::forward<Args>(args)...);
+		guard.elem = nullptr;
+
+		return ret;
+	}
+
+	template<typename... Args>
+	ElemType *Emplace(Args &&... args) {
+		return Emplace(AllocId(SLMEM_NOALLOC_TAG_POLICY_INVALID_ID), std::forward<Args>(args)...);
+	}
+
+	void Destroy(ElemType *elem) {
+		Return<true>(elem);
+	}
+
+	// Owning handle returning the element to this pool when released, args may start with an AllocId
+	template<typename... Args>
+	UniquePtr MakeUnique(Args &&... args) {
+		return UniquePtr(Emplace(std::forward<Args>(args)...), PoolInstanceDeleter<PoolAllocatorBitArray>{ this });
+	}
+
+	// Releases every page only made of free slots, their content is unspecified afterwards and they're committed again on next use.
+	// The pre-allocated data must be anonymous memory (see VirtualMemory::Decommit). Returns the bytes that were resident.
+	// DecommitPolicy provides the static PageSize/Decommit calls, e.g. VirtualMemory from mem_map.h.
+	template<typename DecommitPolicy>
+	size_t Reclaim() {
+		assert(dataAsVoid && "Preallocated data not set.");
+
+		const uintptr_t pageSize = DecommitPolicy::PageSize();
+		const uintptr_t begin = uintptr_t(dataAsVoid);
+		const uintptr_t end = begin + NeededSizeInBytes;
+
+		size_t releasedSize = 0;
+		uintptr_t runBegin = 0;
+		uintptr_t page = (begin + pageSize - 1) & ~(pageSize - 1);
+		for (; page + pageSize <= end; page += pageSize) {
+			if (areFree((page - begin) / sizeof(ElemType), (page + pageSize - 1 - begin) / sizeof(ElemType))) {
+				runBegin = runBegin ? runBegin : page;
+			}
+			else if (runBegin) {
+				releasedSize += releaseRun<DecommitPolicy>(runBegin, page);
+				runBegin = 0;
+			}
+		}
+
+		if (runBegin) {
+			releasedSize += releaseRun<DecommitPolicy>(runBegin, page);
+		}
+
+		return releasedSize;
 	}
 
 	size_t GetCount() const {
 		return count;
 	}
 
+	// Number of Get/Return calls so far, tells whether the pool was used between two points in time
+	size_t GetActivity() const {
+		return activity;
+	}
+
 	static constexpr size_t NeededSizeInBytes = sizeof(ElemType) * Capacity;
 
 private:
 	static constexpr size_t ElemTypeSize = sizeof(ElemType);
 	static constexpr size_t ElemsUsageCount = (Capacity + 31) / 32;
 
+	bool areFree(size_t first, size_t last) const {
+		for (size_t i = first; i <= last; i++) {
+			if (!isFree(int(i >> 5), int(i % 32)))
+				return false;
+		}
+
+		return true;
+	}
+
+	template<typename DecommitPolicy>
+	size_t releaseRun(uintptr_t runBegin, uintptr_t runEnd) {
+		if (HardeningPolicy::Enabled) {
+			const uintptr_t begin = uintptr_t(dataAsVoid);
+			for (size_t i = (runBegin - begin) / sizeof(ElemType); i <= (runEnd - 1 - begin) / sizeof(ElemType); i++) {
+				this->MarkReleased(i);
+			}
+		}
+
+		return DecommitPolicy::Decommit(reinterpret_cast<void*>(runBegin), runEnd - runBegin);
+	}
+
 	void findFree(int &index, int &bit) {
 		for (int local_index = 0; local_index < ElemsUsageCount; local_index++) {
 			for (int local_bit = 0; local_bit < 32; local_bit++) {
@@ -258,11 +620,15 @@ private:
 
 	int elemsUsage[ElemsUsageCount];
 	size_t count = 0;
+	size_t activity = 0;
 };
 
-template<typename ElemType, size_t Capacity, typename AllocTagPolicy = NoAllocTagPolicy, typename LeakDetectPolicy = NoLeakDetectPolicy, typename FallbackPolicy = NoFallbackPolicy>
+template<typename ElemType, size_t Capacity, typename AllocTagPolicy = NoAllocTagPolicy, typename LeakDetectPolicy = NoLeakDetectPolicy, typename FallbackPolicy = NoFallbackPolicy, typename HardeningPolicy = NoHardeningPolicy>
 class PoolAllocatorFreelist {
 public:
+	typedef ElemType ElementType;
+	typedef std::unique_ptr<ElemType, PoolInstanceDeleter<PoolAllocatorFreelist>> UniquePtr;
+
 	PoolAllocatorFreelist(void *preAllocatedData, size_t size) {
 		SetData(preAllocatedData, size);
 	}
@@ -277,15 +643,11 @@ public:
 		static_assert(sizeof(ElemType) >= sizeof(void*), "Pool element size must be greater than a pointer size.");
 		assert(NeededSizeInBytes <= size && "Pre-allocated data is smaller than the allocator required size.");
 
+		// slots are only linked once returned, the ones never handed out are taken in order past initializedCount,
+		// so the pre-allocated data isn't touched (nor committed) before being used
 		data = preAllocatedData;
-		freeElemHead = (FreelistNode*)data;
-
-		for (size_t i = 0; i < Capacity - 1; i++) {
-			FreelistNode *curr = (FreelistNode *)(&((ElemType*)data)[i]);
-			FreelistNode *next = (FreelistNode *)(&((ElemType*)data)[i + 1]);
-			curr->next =  next;
-		}
-		((FreelistNode *)(&((ElemType*)data)[Capacity - 1]))->next = nullptr;
+		freeElemHead = nullptr;
+		initializedCount = 0;
 	}
 
 	bool HasData() const {
@@ -296,19 +658,41 @@ public:
 	// it to be validated accordingly by the AllocatorTrait?
 	template<bool ShouldConstruct = false>
 	ElemType *Get(const char *allocId = SLMEM_NOALLOC_TAG_POLICY_INVALID_ID) {
-		if (!freeElemHead) {
+		assert(data && "Preallocated data not set.");
+
+		activity++;
+
+		ElemType *ret = nullptr;
+		if (freeElemHead) {
+			ret = (ElemType*)freeElemHead;
+			FreelistNode *next = (FreelistNode*)HardeningPolicy::DecodeLink(freeElemHead->next, freeElemHead);
+
+			if (HardeningPolicy::Enabled) {
+				if (next && !isPoolSlot(next)) {
+					HardeningPolicy::OnCorruption("Freelist link corrupted.", ret);
+					next = nullptr;
+				}
+
+				HardeningPolicy::OnAlloc(ret, sizeof(ElemType), sizeof(FreelistNode));
+			}
+
+			freeElemHead = next;
+		}
+		else if (initializedCount < Capacity) {
+			ret = &((ElemType*)data)[initializedCount++];
+
+			if (HardeningPolicy::Enabled)
+				HardeningPolicy::OnAllocClean(ret, sizeof(ElemType), sizeof(FreelistNode));
+		}
+		else {
 			FallbackPolicy::OnAlloc(nullptr, sizeof(ElemType));
 			return nullptr;
 		}
 
-		ElemType *ret = (ElemType*)freeElemHead;
 		AllocTagPolicy::Tag(ret, allocId, sizeof(ElemType));
 		LeakDetectPolicy::Assign(ret, sizeof(ElemType));
 
-		if (ShouldConstruct)
-			new (ret) ElemType;
-
-		freeElemHead = freeElemHead->next;
+		PoolElemConstructor<ShouldConstruct>::Construct(ret);
 
 		assert(count < Capacity && "Internal error. There's a free element while the current count is already at Capacity.");
 		count++;
@@ -319,6 +703,13 @@ public:
 	void Return(ElemType *elem) {
 		assert((elem >= (ElemType*)data && elem < (ElemType*)data + Capacity) && "The element is not within this pool range.");
 
+		activity++;
+
+		if (HardeningPolicy::Enabled && HardeningPolicy::IsFreed(elem, sizeof(ElemType), sizeof(FreelistNode))) {
+			HardeningPolicy::OnCorruption("Element already returned.", elem);
+			return;
+		}
+
 		LeakDetectPolicy::Unassign(elem);
 		AllocTagPolicy::Untag(elem);
 
@@ -327,16 +718,82 @@ public:
 
 		FreelistNode *prevFree = freeElemHead;
 		freeElemHead = (FreelistNode*)elem;
-		freeElemHead->next = prevFree;
+		freeElemHead->next = (FreelistNode*)HardeningPolicy::EncodeLink(prevFree, freeElemHead);
+
+		if (HardeningPolicy::Enabled)
+			HardeningPolicy::OnFree(elem, sizeof(ElemType), sizeof(FreelistNode));
 
 		assert(count && "Internal error. Freeing an element while count is already at 0.");
 		count--;
 	}
 
+	// Constructs the element in place from args, returns nullptr when the pool is full
+	template<typename... Args>
+	ElemType *Emplace(AllocId allocId, Args &&... args) {
+		PoolReturnGuard<PoolAllocatorFreelist> guard{ *this, Get(allocId.id) };
+		if (!guard.elem)
+			return nullptr;
+
+		ElemType *ret = new (guard.elem) ElemType(std::forward<Args>(args)...);
+		guard.elem = nullptr;
+
+		return ret;
+	}
+
+	template<typename... Args>
+	ElemType *Emplace(Args &&... args) {
+		return Emplace(AllocId(SLMEM_NOALLOC_TAG_POLICY_INVALID_ID), std::forward<Args>(args)...);
+	}
+
+	void Destroy(ElemType *elem) {
+		Return<true>(elem);
+	}
+
+	// Owning handle returning the element to this pool when released, args may start with an AllocId
+	template<typename... Args>
+	UniquePtr MakeUnique(Args &&... args) {
+		return UniquePtr(Emplace(std::forward<Args>(args)...), PoolInstanceDeleter<PoolAllocatorFreelist>{ this });
+	}
+
+	// Releases the pages past the last slot in use: the trailing free slots are unlinked from the freelist and will be
+	// handed out again in order, committing their pages back on use. The pre-allocated data must be anonymous memory
+	// (see VirtualMemory::Decommit), the content of released slots is unspecified.
+	// Returns the bytes that were resident. DecommitPolicy provides the static DecommitRange call, e.g. VirtualMemory from mem_map.h.
+	template<typename DecommitPolicy>
+	size_t Reclaim() {
+		assert(data && "Preallocated data not set.");
+
+		// lowest slot from which every handed out slot is back in the freelist, the predicate is monotonic
+		// so binary search it, each step walking the freelist once
+		size_t low = 0;
+		size_t high = initializedCount;
+		while (low < high) {
+			const size_t mid = (low + high) / 2;
+			if (countFreeFrom(mid) == initializedCount - mid) {
+				high = mid;
+			}
+			else {
+				low = mid + 1;
+			}
+		}
+
+		if (low < initializedCount) {
+			unlinkFrom(low);
+			initializedCount = low;
+		}
+
+		return DecommitPolicy::DecommitRange(&((ElemType*)data)[initializedCount], (unsigned char*)data + NeededSizeInBytes);
+	}
+
 	size_t GetCount() const {
 		return count;
 	}
 
+	// Number of Get/Return calls so far, tells whether the pool was used between two points in time
+	size_t GetActivity() const {
+		return activity;
+	}
+
 	static constexpr size_t NeededSizeInBytes = sizeof(ElemType) * Capacity;
 
 private:
@@ -346,10 +803,49 @@ private:
 		FreelistNode *next = nullptr;
 	};
 
+	bool isPoolSlot(const FreelistNode *node) const {
+		const size_t offset = uintptr_t(node) - uintptr_t(data);
+		return offset < NeededSizeInBytes && offset % sizeof(ElemType) == 0;
+	}
+
+	size_t slotIndex(const FreelistNode *node) const {
+		return (ElemType*)node - (ElemType*)data;
+	}
+
+	size_t countFreeFrom(size_t index) const {
+		size_t freeCount = 0;
+		for (FreelistNode *node = freeElemHead; node; node = (FreelistNode*)HardeningPolicy::DecodeLink(node->next, node)) {
+			freeCount += slotIndex(node) >= index ? 1 : 0;
+		}
+
+		return freeCount;
+	}
+
+	void unlinkFrom(size_t index) {
+		FreelistNode *prev = nullptr;
+		FreelistNode *node = freeElemHead;
+		while (node) {
+			FreelistNode *next = (FreelistNode*)HardeningPolicy::DecodeLink(node->next, node);
+			if (slotIndex(node) < index) {
+				prev = node;
+			}
+			else if (prev) {
+				prev->next = (FreelistNode*)HardeningPolicy::EncodeLink(next, prev);
+			}
+			else {
+				freeElemHead = next;
+			}
+
+			node = next;
+		}
+	}
+
 	void *data = nullptr;
 
 	FreelistNode *freeElemHead = nullptr;
+	size_t initializedCount = 0;
 
 	size_t count = 0;
+	size_t activity = 0;
 };
 
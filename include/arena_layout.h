@@ -0,0 +1,136 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.h"
+
+
+// Arena layout planner
+// Computes at compile time where each allocator's pre-allocated data lives inside one block, so a whole set
+// of pools, linear allocators and debug policy tables can be fed from a single allocation (static array, mmap, ...).
+// Slots are laid out in the order they are listed, each one starting on an Alignment boundary, so listing hot
+// pools next to each other keeps them adjacent in memory while never sharing a cache line.
+//
+//	typedef CacheAlignedArenaLayout<MyLeakDetectPolicy, MyPool, ArenaSized<MyLinearAllocator, 4096>> MyArena;
+//	alignas(MyArena::NeededAlignment) static char arena[MyArena::NeededSizeInBytes];
+//	MyArena::SetData(arena, sizeof(arena), MyLeakDetectPolicy(), myPool, myLinearAllocator);
+
+// Wraps allocators that don't expose a compile-time NeededSizeInBytes (e.g. LinearAllocator)
+template<typename T, size_t Size>
+struct ArenaSized {
+};
+
+template<typename T>
+struct ArenaVoid {
+	typedef void Type;
+};
+
+// Alignment the slot data needs: the element alignment for allocators exposing an ElementType (pools), 1 otherwise
+template<typename T, typename = void>
+struct ArenaSlotAlignment {
+	static constexpr size_t Value = 1;
+};
+
+template<typename T>
+struct ArenaSlotAlignment<T, typename ArenaVoid<typename T::ElementType>::Type> {
+	static constexpr size_t Value = alignof(typename T::ElementType);
+};
+
+template<typename Slot>
+struct ArenaSlotTraits {
+	typedef Slot Type;
+	static constexpr size_t NeededSizeInBytes = Slot::NeededSizeInBytes;
+	static constexpr size_t NeededAlignment = ArenaSlotAlignment<Slot>::Value;
+};
+
+template<typename T, size_t Size>
+struct ArenaSlotTraits<ArenaSized<T, Size>> {
+	typedef T Type;
+	static constexpr size_t NeededSizeInBytes = Size;
+	static constexpr size_t NeededAlignment = ArenaSlotAlignment<T>::Value;
+};
+
+template<size_t Alignment, size_t Offset, typename... Slots>
+struct ArenaLayoutNode {
+	static constexpr size_t EndOffset = Offset;
+
+	static void SetData(unsigned char * /*arena*/) {}
+};
+
+template<size_t Alignment, size_t Offset, typename Slot, typename... Rest>
+struct ArenaLayoutNode<Alignment, Offset, Slot, Rest...> {
+	typedef ArenaSlotTraits<Slot> Traits;
+
+	static_assert(Alignment >= Traits::NeededAlignment, "Arena alignment is smaller than the slot element alignment.");
+
+	static constexpr size_t SlotOffset = Offset;
+	static constexpr size_t SlotSize = Traits::NeededSizeInBytes;
+
+	typedef ArenaLayoutNode<Alignment, (Offset + SlotSize + Alignment - 1) & ~(Alignment - 1), Rest...> Next;
+
+	static constexpr size_t EndOffset = Next::EndOffset;
+
+	template<typename Instance, typename... RestInstances>
+	static void SetData(unsigned char *arena, Instance &&instance, RestInstances &&... rest) {
+		static_assert(std::is_same<typename std::decay<Instance>::type, typename Traits::Type>::value, "Allocator instance type doesn't match the arena slot type.");
+
+		instance.SetData(arena + SlotOffset, SlotSize);
+		Next::SetData(arena, std::forward<RestInstances>(rest)...);
+	}
+};
+
+template<size_t Index, typename Node>
+struct ArenaLayoutAt {
+	typedef typename ArenaLayoutAt<Index - 1, typename Node::Next>::Type Type;
+};
+
+template<typename Node>
+struct ArenaLayoutAt<0, Node> {
+	typedef Node Type;
+};
+
+template<size_t Alignment, typename... Slots>
+class ArenaLayout {
+	static_assert(Alignment && (Alignment & (Alignment - 1)) == 0, "Arena alignment must be a power of two.");
+
+	typedef ArenaLayoutNode<Alignment, 0, Slots...> Root;
+
+public:
+	template<size_t Index>
+	static constexpr size_t OffsetOf() {
+		return ArenaLayoutAt<Index, Root>::Type::SlotOffset;
+	}
+
+	template<size_t Index>
+	static constexpr size_t SizeOf() {
+		return ArenaLayoutAt<Index, Root>::Type::SlotSize;
+	}
+
+	template<size_t Index>
+	static void *GetData(void *arena) {
+		return static_cast<unsigned char*>(arena) + OffsetOf<Index>();
+	}
+
+	// Hands every allocator its slot, instances must be given in the same order as the layout slots.
+	// Policies only exposing static SetData can be passed as temporaries, e.g. MyLeakDetectPolicy().
+	template<typename... Instances>
+	static void SetData(void *arena, size_t size, Instances &&... instances) {
+		static_assert(sizeof...(Instances) == Count, "One allocator instance per arena slot is required.");
+		assert(arena && "Arena data not set.");
+		assert((uintptr_t(arena) & (Alignment - 1)) == 0 && "Arena data isn't aligned on the layout alignment.");
+		assert(NeededSizeInBytes <= size && "Arena data is smaller than the layout required size.");
+
+		Root::SetData(static_cast<unsigned char*>(arena), std::forward<Instances>(instances)...);
+	}
+
+	static constexpr size_t Count = sizeof...(Slots);
+	static constexpr size_t NeededAlignment = Alignment;
+	static constexpr size_t NeededSizeInBytes = Root::EndOffset;
+};
+
+template<typename... Slots>
+using CacheAlignedArenaLayout = ArenaLayout<SLMEM_CACHE_LINE_SIZE, Slots...>;
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // #if !defined(_WIN32)
+
+// MADV_FREE is cheaper than MADV_DONTNEED as pages are only taken back under memory pressure,
+// but it only applies to private anonymous memory and the RSS doesn't drop right away
+#if defined(SLMEM_DECOMMIT_USE_MADV_FREE) && defined(MADV_FREE)
+#define SLMEM_DECOMMIT_ADVICE	MADV_FREE
+#else
+#define SLMEM_DECOMMIT_ADVICE	MADV_DONTNEED
+#endif // #if defined(SLMEM_DECOMMIT_USE_MADV_FREE) && defined(MADV_FREE)
+
+
+// Thin wrapper over the OS virtual memory calls needed by the mapped allocators.
+// Only POSIX is implemented for now, on other platforms mapping calls fail and return nullptr/false.
+class VirtualMemory {
+public:
+	static size_t PageSize() {
+#if !defined(_WIN32)
+		static const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+		return pageSize;
+#else
+		return 4096;
+#endif // #if !defined(_WIN32)
+	}
+
+	// Maps size bytes of the file at path as shared read/write memory, creating and sizing the file when it's empty.
+	// hadData is set when the file wasn't empty, i.e. it may hold a previous mapping content. Such a file is only
+	// grown to size when allowGrow is set, otherwise mapping fails when it's shorter than size.
+	static void *MapFile(const char *path, size_t size, bool &hadData, bool allowGrow = false) {
+		hadData = false;
+#if !defined(_WIN32)
+		const int fd = open(path, O_RDWR | O_CREAT, 0644);
+		if (fd == -1) {
+			return nullptr;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) == -1) {
+			close(fd);
+			return nullptr;
+		}
+
+		hadData = st.st_size > 0;
+		const bool tooShort = size_t(st.st_size) < size;
+		if (tooShort && ((hadData && !allowGrow) || ftruncate(fd, off_t(size)) == -1)) {
+			close(fd);
+			return nullptr;
+		}
+
+		void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+
+		return addr != MAP_FAILED ? addr : nullptr;
+#else
+		return nullptr;
+#endif // #if !defined(_WIN32)
+	}
+
+	// Synchronously writes back the dirty pages of a file mapping
+	static bool Flush(void *addr, size_t size) {
+#if !defined(_WIN32)
+		return msync(addr, size, MS_SYNC) == 0;
+#else
+		return false;
+#endif // #if !defined(_WIN32)
+	}
+
+	// Maps size bytes of the POSIX shared memory object name, creating and sizing it when create is set
+	static void *MapShared(const char *name, size_t size, bool create) {
+#if !defined(_WIN32)
+		const int fd = shm_open(name, O_RDWR | (create ? O_CREAT : 0), 0600);
+		if (fd == -1) {
+			return nullptr;
+		}
+
+		struct stat st;
+		if (create ? ftruncate(fd, off_t(size)) == -1 : (fstat(fd, &st) == -1 || size_t(st.st_size) < size)) {
+			close(fd);
+			return nullptr;
+		}
+
+		void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+
+		return addr != MAP_FAILED ? addr : nullptr;
+#else
+		return nullptr;
+#endif // #if !defined(_WIN32)
+	}
+
+	static bool UnlinkShared(const char *name) {
+#if !defined(_WIN32)
+		return shm_unlink(name) == 0;
+#else
+		return false;
+#endif // #if !defined(_WIN32)
+	}
+
+	// Releases the physical pages of the page aligned range, they are committed again on next access.
+	// Only meant for anonymous memory (anonymous mappings, heap, stack or zero-initialized static buffers living in .bss)
+	// whose content can be discarded. The content read back afterwards is unspecified: MADV_FREE pages may keep their
+	// old data, and pages of an initialized static buffer (.data) come back with their initial file content.
+	// Returns how many bytes of the range were resident.
+	static size_t Decommit(void *addr, size_t size) {
+#if !defined(_WIN32)
+		const size_t pageSize = PageSize();
+		assert((uintptr_t(addr) & (pageSize - 1)) == 0 && (size & (pageSize - 1)) == 0 && "Decommit range must be page aligned.");
+
+		static constexpr size_t ChunkPageCount = 64;
+#if defined(__APPLE__)
+		char residency[ChunkPageCount];
+#else
+		unsigned char residency[ChunkPageCount];
+#endif // #if defined(__APPLE__)
+
+		size_t residentSize = 0;
+		unsigned char *bytes = static_cast<unsigned char*>(addr);
+		for (size_t offset = 0; offset < size; offset += ChunkPageCount * pageSize) {
+			const size_t chunkSize = size - offset < ChunkPageCount * pageSize ? size - offset : ChunkPageCount * pageSize;
+			if (mincore(bytes + offset, chunkSize, residency) == 0) {
+				for (size_t i = 0; i < chunkSize / pageSize; i++) {
+					residentSize += (residency[i] & 1) ? pageSize : 0;
+				}
+			}
+		}
+
+		return madvise(addr, size, SLMEM_DECOMMIT_ADVICE) == 0 ? residentSize : 0;
+#else
+		return 0;
+#endif // #if !defined(_WIN32)
+	}
+
+	// Decommits the whole pages contained in [begin, end)
+	static size_t DecommitRange(const void *begin, const void *end) {
+		const uintptr_t pageMask = PageSize() - 1;
+		const uintptr_t first = (uintptr_t(begin) + pageMask) & ~pageMask;
+		const uintptr_t last = uintptr_t(end) & ~pageMask;
+
+		return first < last ? Decommit(reinterpret_cast<void*>(first), last - first) : 0;
+	}
+
+	static void Unmap(void *addr, size_t size) {
+#if !defined(_WIN32)
+		munmap(addr, size);
+#endif // #if !defined(_WIN32)
+	}
+};
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "allocator.h"
+#include "mem_map.h"
+
+
+#define SLMEM_PERSISTENT_POOL_MAGIC		0x4C4F4F504D454D53ull	// "SMEMPOOL"
+#define SLMEM_PERSISTENT_POOL_VERSION	1
+
+// Pool allocator whose data and metadata (header, usage bitmap, freelist) all live in the pre-allocated block.
+// Freelist links are slot indices instead of pointers, so the block is relocatable: it can be backed by a file
+// (see Open) and mapped back at any address by another run of the process, which re-attaches to it in O(1)
+// and finds its live elements intact. Elements must therefore be trivially copyable and must not hold raw
+// pointers, use ToOffset/FromOffset to reference other elements of the pool.
+// Nothing is written back to the file until Flush or Close is called (or the OS decides to). The header keeps a clean
+// flag set by Flush and cleared by the first change made after it, so a file left by a crash between the two is
+// never trusted by Open.
+template<typename ElemType, size_t Capacity, typename AllocTagPolicy = NoAllocTagPolicy, typename LeakDetectPolicy = NoLeakDetectPolicy, typename FallbackPolicy = NoFallbackPolicy>
+class PoolAllocatorPersistent {
+	static_assert(sizeof(ElemType) >= sizeof(uint32_t), "Pool element size must be greater than a freelist offset size.");
+	static_assert(std::is_trivially_copyable<ElemType>::value, "Persistent pool elements must be trivially copyable.");
+	static_assert(Capacity > 0 && Capacity < UINT32_MAX, "Persistent pool capacity must fit a 32 bits offset.");
+
+	struct Header {
+		uint64_t magic;
+		uint32_t version;
+		uint32_t elemSize;
+		uint64_t layoutChecksum;
+		uint64_t capacity;
+		uint64_t count;
+		uint32_t freeElemHead;	// slot offset, see toLink
+		uint32_t clean;		// set by Flush, cleared by the first change after it
+	};
+
+	static constexpr size_t ElemsUsageCount = (Capacity + 31) / 32;
+	static constexpr size_t ElemAlignment = alignof(ElemType) > alignof(Header) ? alignof(ElemType) : alignof(Header);
+	static constexpr size_t ElemsOffset = (sizeof(Header) + ElemsUsageCount * sizeof(uint32_t) + ElemAlignment - 1) & ~(ElemAlignment - 1);
+
+public:
+	static constexpr uint32_t InvalidOffset = UINT32_MAX;
+
+	PoolAllocatorPersistent(void *preAllocatedData, size_t size) {
+		SetData(preAllocatedData, size);
+	}
+
+	PoolAllocatorPersistent() {
+	}
+
+	~PoolAllocatorPersistent() {
+		Close();
+	}
+
+	// The object owns the mapping made by Open, copies would unmap it behind each other's back
+	PoolAllocatorPersistent(const PoolAllocatorPersistent &) = delete;
+	PoolAllocatorPersistent &operator=(const PoolAllocatorPersistent &) = delete;
+
+	// Maps the pool onto the file at path, initializing a new pool when the file is new or empty.
+	// A file with any other content is only re-attached to when it holds a cleanly flushed pool with the same layout,
+	// otherwise Open fails and leaves the file untouched, unless discardInvalid is set to reinitialize it (growing it
+	// when it's shorter than the pool).
+	bool Open(const char *path, bool discardInvalid = false) {
+		Close();
+
+		bool hadData = false;
+		void *mapped = VirtualMemory::MapFile(path, NeededSizeInBytes, hadData, discardInvalid);
+		if (!mapped) {
+			return false;
+		}
+
+		setPointers(mapped);
+		if (hadData && !discardInvalid && !(isHeaderValid() && header->clean)) {
+			VirtualMemory::Unmap(mapped, NeededSizeInBytes);
+			setPointers(nullptr);
+			return false;
+		}
+
+		mappedData = mapped;
+		restored = hadData && isHeaderValid() && header->clean;
+		if (!restored) {
+			Reset();
+		}
+
+		return true;
+	}
+
+	// Flushes the pool before unmapping it
+	void Close() {
+		if (mappedData) {
+			Flush();
+			VirtualMemory::Unmap(mappedData, NeededSizeInBytes);
+			mappedData = nullptr;
+		}
+
+		setPointers(nullptr);
+		restored = false;
+	}
+
+	// Explicit persistence point, blocks until the mapping is written back to the file then marks the pool clean.
+	// msync doesn't order the writes of different pages, so the clean flag only reaches the file in a second msync,
+	// once everything it covers is there.
+	bool Flush() {
+		assert(mappedData && "Pool isn't mapped onto a file.");
+
+		if (!VirtualMemory::Flush(mappedData, NeededSizeInBytes)) {
+			return false;
+		}
+
+		header->clean = 1;
+		return VirtualMemory::Flush(mappedData, sizeof(Header));
+	}
+
+	// Attaches to the block if it holds a valid pool header, otherwise initializes a new empty pool in it.
+	// The clean flag isn't checked, the caller is trusted to hand over a block that wasn't left torn.
+	void SetData(void *preAllocatedData, size_t size) {
+		assert(NeededSizeInBytes <= size && "Pre-allocated data is smaller than the allocator required size.");
+		assert((uintptr_t(preAllocatedData) & (ElemAlignment - 1)) == 0 && "Pre-allocated data isn't aligned for the pool header.");
+
+		setPointers(preAllocatedData);
+
+		restored = isHeaderValid();
+		if (!restored) {
+			Reset();
+		}
+	}
+
+	bool HasData() const {
+		return header != nullptr;
+	}
+
+	// True when the last SetData/Open re-attached to an existing pool instead of creating a new one
+	bool WasRestored() const {
+		return restored;
+	}
+
+	// Returns every element to the pool
+	void Reset() {
+		assert(header && "Preallocated data not set.");
+
+		markDirty();
+		memset(elemsUsage, 0, ElemsUsageCount * sizeof(uint32_t));
+
+		for (size_t i = 0; i < Capacity - 1; i++) {
+			setNext(i, toLink(i + 1));
+		}
+		setNext(Capacity - 1, InvalidOffset);
+
+		header->freeElemHead = toLink(0);
+		header->count = 0;
+		header->capacity = Capacity;
+		header->layoutChecksum = LayoutChecksum();
+		header->elemSize = sizeof(ElemType);
+		header->version = SLMEM_PERSISTENT_POOL_VERSION;
+		header->magic = SLMEM_PERSISTENT_POOL_MAGIC;
+	}
+
+	ElemType *Get(const char *allocId = SLMEM_NOALLOC_TAG_POLICY_INVALID_ID) {
+		assert(header && "Preallocated data not set.");
+
+		if (header->freeElemHead == InvalidOffset) {
+			FallbackPolicy::OnAlloc(nullptr, sizeof(ElemType));
+			return nullptr;
+		}
+
+		const size_t poolIndex = header->freeElemHead;
+		assert(poolIndex < Capacity && "Internal error. Freelist offset out of the pool range.");
+		assert(isFree(poolIndex) && "Internal error. Freelist head doesn't point to a free slot.");
+
+		markDirty();
+		header->freeElemHead = getNext(poolIndex);
+		elemsUsage[poolIndex >> 5] |= (1u << (poolIndex % 32));
+
+		assert(header->count < Capacity && "Internal error. There's a free element while the current count is already at Capacity.");
+		header->count++;
+
+		ElemType *ret = &elems[poolIndex];
+		AllocTagPolicy::Tag(ret, allocId, sizeof(ElemType));
+		LeakDetectPolicy::Assign(ret, sizeof(ElemType));
+
+		return ret;
+	}
+
+	void Return(ElemType *elem) {
+		assert((elem >= elems && elem < elems + Capacity) && "The element is not within this pool range.");
+
+		const size_t poolIndex = elem - elems;
+		assert(!isFree(poolIndex) && "Element already freed.");
+
+		LeakDetectPolicy::Unassign(elem);
+		AllocTagPolicy::Untag(elem);
+
+		markDirty();
+		elemsUsage[poolIndex >> 5] &= ~(1u << (poolIndex % 32));
+		setNext(poolIndex, header->freeElemHead);
+		header->freeElemHead = toLink(poolIndex);
+
+		assert(header->count && "Internal error. Freeing an element while count is already at 0.");
+		header->count--;
+	}
+
+	size_t GetCount() const {
+		return header ? size_t(header->count) : 0;
+	}
+
+	bool IsLive(const ElemType *elem) const {
+		assert((elem >= elems && elem < elems + Capacity) && "The element is not within this pool range.");
+		return !isFree(elem - elems);
+	}
+
+	template<typename Func>
+	void EnumerateLive(Func func) {
+		for (size_t i = 0; i < Capacity; i++) {
+			if (!isFree(i)) {
+				func(elems[i]);
+			}
+		}
+	}
+
+	// Position independent element references, valid across mappings of the same pool
+	uint32_t ToOffset(const ElemType *elem) const {
+		if (!elem) {
+			return InvalidOffset;
+		}
+
+		assert((elem >= elems && elem < elems + Capacity) && "The element is not within this pool range.");
+		return toLink(elem - elems);
+	}
+
+	ElemType *FromOffset(uint32_t offset) const {
+		if (offset == InvalidOffset) {
+			return nullptr;
+		}
+
+		assert(offset < Capacity && "Offset out of the pool range.");
+		return &elems[offset];
+	}
+
+	// Identifies the pool layout, a block created with a different layout is never re-attached to
+	static constexpr uint64_t LayoutChecksum() {
+		return fnv1a(fnv1a(fnv1a(fnv1a(fnv1a(0xcbf29ce484222325ull, SLMEM_PERSISTENT_POOL_VERSION), sizeof(ElemType)), alignof(ElemType)), Capacity), ElemsOffset);
+	}
+
+	static constexpr size_t NeededSizeInBytes = ElemsOffset + sizeof(ElemType) * Capacity;
+
+private:
+	static constexpr uint64_t fnv1a(uint64_t hash, uint64_t value, int byte = 0) {
+		return byte == 8 ? hash : fnv1a((hash ^ ((value >> (byte * 8)) & 0xff)) * 0x100000001b3ull, value, byte + 1);
+	}
+
+	static uint32_t toLink(size_t poolIndex) {
+		return uint32_t(poolIndex);
+	}
+
+	void setPointers(void *preAllocatedData) {
+		unsigned char *block = static_cast<unsigned char*>(preAllocatedData);
+		header = reinterpret_cast<Header*>(block);
+		elemsUsage = block ? reinterpret_cast<uint32_t*>(block + sizeof(Header)) : nullptr;
+		elems = block ? reinterpret_cast<ElemType*>(block + ElemsOffset) : nullptr;
+	}
+
+	// The cleared flag reaches the file before the change it covers, so a crash can't leave a torn pool marked clean
+	void markDirty() {
+		if (!header->clean)
+			return;
+
+		header->clean = 0;
+		if (mappedData) {
+			VirtualMemory::Flush(mappedData, sizeof(Header));
+		}
+	}
+
+	bool isHeaderValid() const {
+		return header->magic == SLMEM_PERSISTENT_POOL_MAGIC
+			&& header->version == SLMEM_PERSISTENT_POOL_VERSION
+			&& header->layoutChecksum == LayoutChecksum()
+			&& header->capacity == Capacity
+			&& header->elemSize == sizeof(ElemType)
+			&& header->count <= Capacity
+			&& (header->freeElemHead == InvalidOffset || header->freeElemHead < Capacity);
+	}
+
+	bool isFree(size_t poolIndex) const {
+		return (elemsUsage[poolIndex >> 5] & (1u << (poolIndex % 32))) == 0;
+	}
+
+	// The link is stored with memcpy as free slots hold no live ElemType
+	uint32_t getNext(size_t poolIndex) const {
+		uint32_t next;
+		memcpy(&next, &elems[poolIndex], sizeof(next));
+		return next;
+	}
+
+	void setNext(size_t poolIndex, uint32_t next) {
+		memcpy(&elems[poolIndex], &next, sizeof(next));
+	}
+
+	Header *header = nullptr;
+	uint32_t *elemsUsage = nullptr;
+	ElemType *elems = nullptr;
+
+	void *mappedData = nullptr;
+	bool restored = false;
+};
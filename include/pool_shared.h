@@ -0,0 +1,233 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include <type_traits>
+
+#include "allocator.h"
+#include "mem_map.h"
+
+
+#define SLMEM_SHARED_POOL_MAGIC		0x4C4F4F5044524853ull	// "SHRDPOOL"
+#define SLMEM_SHARED_POOL_VERSION	1
+
+// Pool allocator living in POSIX shared memory, usable concurrently by every process attached to it.
+// The design follows PoolAllocatorFreelist but the freelist links are slot indices and the head is a lock-free
+// atomic (slot index + ABA tag) stored in the shared block, so any process can Get an element, fill it, pass its
+// Handle to another process, which can then resolve it with FromHandle and Return it: zero-copy IPC.
+// Elements must be trivially copyable and must not hold raw pointers, the block is mapped at a different
+// address in each process. Slots held by a process that dies are not recovered.
+template<typename ElemType, size_t Capacity, typename AllocTagPolicy = NoAllocTagPolicy, typename LeakDetectPolicy = NoLeakDetectPolicy, typename FallbackPolicy = NoFallbackPolicy>
+class PoolAllocatorShared {
+	typedef std::atomic<uint32_t> FreelistNode;
+
+	static_assert(sizeof(ElemType) >= sizeof(FreelistNode), "Pool element size must be greater than a freelist offset size.");
+	static_assert(sizeof(ElemType) % alignof(FreelistNode) == 0, "Pool element size must be a multiple of the freelist offset alignment.");
+	static_assert(std::is_trivially_copyable<ElemType>::value, "Shared pool elements must be trivially copyable.");
+	static_assert(Capacity > 0 && Capacity < UINT32_MAX, "Shared pool capacity must fit a 32 bits offset.");
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "Shared pool requires lock-free atomics to be process-shared.");
+
+	struct Header {
+		std::atomic<uint64_t> magic{ 0 };
+		uint32_t version = 0;
+		uint32_t elemSize = 0;
+		uint64_t capacity = 0;
+		alignas(SLMEM_CACHE_LINE_SIZE) std::atomic<uint64_t> freeElemHead{ 0 };	// tag << 32 | slot offset
+		alignas(SLMEM_CACHE_LINE_SIZE) std::atomic<uint32_t> count{ 0 };
+	};
+
+	static constexpr size_t ElemAlignment = alignof(ElemType) > alignof(Header) ? alignof(ElemType) : alignof(Header);
+	static constexpr size_t ElemsOffset = (sizeof(Header) + ElemAlignment - 1) & ~(ElemAlignment - 1);
+
+public:
+	typedef uint32_t Handle;
+
+	static constexpr Handle InvalidHandle = UINT32_MAX;
+
+	PoolAllocatorShared() {
+	}
+
+	~PoolAllocatorShared() {
+		Close();
+	}
+
+	// The object owns the mapping made by Create/Open, copies would unmap it behind each other's back
+	PoolAllocatorShared(const PoolAllocatorShared &) = delete;
+	PoolAllocatorShared &operator=(const PoolAllocatorShared &) = delete;
+
+	// Creates (or re-creates) the shared memory object name and initializes an empty pool in it
+	bool Create(const char *name) {
+		Close();
+
+		void *mapped = VirtualMemory::MapShared(name, NeededSizeInBytes, true);
+		if (!mapped) {
+			return false;
+		}
+
+		mappedData = mapped;
+		SetData(mapped, NeededSizeInBytes);
+
+		return true;
+	}
+
+	// Attaches to a pool previously created by Create in this or any other process
+	bool Open(const char *name) {
+		Close();
+
+		void *mapped = VirtualMemory::MapShared(name, NeededSizeInBytes, false);
+		if (!mapped) {
+			return false;
+		}
+
+		mappedData = mapped;
+		setPointers(mapped);
+
+		if (!isHeaderValid()) {
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void Close() {
+		if (mappedData) {
+			VirtualMemory::Unmap(mappedData, NeededSizeInBytes);
+			mappedData = nullptr;
+		}
+
+		header = nullptr;
+		elems = nullptr;
+	}
+
+	static bool Unlink(const char *name) {
+		return VirtualMemory::UnlinkShared(name);
+	}
+
+	// Initializes an empty pool in the block, which must not be in use by another process yet.
+	// The header magic is published last so processes calling Open never see a partially initialized pool.
+	void SetData(void *preAllocatedData, size_t size) {
+		assert(NeededSizeInBytes <= size && "Pre-allocated data is smaller than the allocator required size.");
+		assert((uintptr_t(preAllocatedData) & (ElemAlignment - 1)) == 0 && "Pre-allocated data isn't aligned for the pool header.");
+
+		setPointers(preAllocatedData);
+
+		// the atomics are constructed in place like the freelist nodes, the magic stays 0 until the pool is ready
+		new (header) Header();
+		header->version = SLMEM_SHARED_POOL_VERSION;
+		header->elemSize = sizeof(ElemType);
+		header->capacity = Capacity;
+
+		for (size_t i = 0; i < Capacity - 1; i++) {
+			new (nodeAt(i)) FreelistNode(uint32_t(i + 1));
+		}
+		new (nodeAt(Capacity - 1)) FreelistNode(InvalidHandle);
+
+		header->magic.store(SLMEM_SHARED_POOL_MAGIC, std::memory_order_release);
+	}
+
+	bool HasData() const {
+		return header != nullptr;
+	}
+
+	ElemType *Get(const char *allocId = SLMEM_NOALLOC_TAG_POLICY_INVALID_ID) {
+		assert(header && "Preallocated data not set.");
+
+		uint64_t head = header->freeElemHead.load(std::memory_order_acquire);
+		for (;;) {
+			const uint32_t poolIndex = uint32_t(head);
+			if (poolIndex == InvalidHandle) {
+				FallbackPolicy::OnAlloc(nullptr, sizeof(ElemType));
+				return nullptr;
+			}
+
+			assert(poolIndex < Capacity && "Internal error. Freelist offset out of the pool range.");
+
+			// the slot may be taken and overwritten by another process meanwhile, the tag makes the exchange fail then
+			const uint32_t next = nodeAt(poolIndex)->load(std::memory_order_relaxed);
+			const uint64_t newHead = (((head >> 32) + 1) << 32) | next;
+			if (header->freeElemHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire)) {
+				break;
+			}
+		}
+
+		header->count.fetch_add(1, std::memory_order_relaxed);
+
+		ElemType *ret = &elems[uint32_t(head)];
+		AllocTagPolicy::Tag(ret, allocId, sizeof(ElemType));
+		LeakDetectPolicy::Assign(ret, sizeof(ElemType));
+
+		return ret;
+	}
+
+	void Return(ElemType *elem) {
+		assert((elem >= elems && elem < elems + Capacity) && "The element is not within this pool range.");
+
+		LeakDetectPolicy::Unassign(elem);
+		AllocTagPolicy::Untag(elem);
+
+		const uint32_t poolIndex = uint32_t(elem - elems);
+		FreelistNode *node = new (nodeAt(poolIndex)) FreelistNode(InvalidHandle);
+
+		uint64_t head = header->freeElemHead.load(std::memory_order_relaxed);
+		uint64_t newHead;
+		do {
+			node->store(uint32_t(head), std::memory_order_relaxed);
+			newHead = (((head >> 32) + 1) << 32) | poolIndex;
+		} while (!header->freeElemHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+
+		const uint32_t prevCount = header->count.fetch_sub(1, std::memory_order_relaxed);
+		assert(prevCount && "Internal error. Freeing an element while count is already at 0.");
+		(void)prevCount;
+	}
+
+	// Elements in flight between processes may make the count momentarily off by the number of concurrent Get/Return
+	size_t GetCount() const {
+		return header ? header->count.load(std::memory_order_relaxed) : 0;
+	}
+
+	Handle ToHandle(const ElemType *elem) const {
+		if (!elem) {
+			return InvalidHandle;
+		}
+
+		assert((elem >= elems && elem < elems + Capacity) && "The element is not within this pool range.");
+		return Handle(elem - elems);
+	}
+
+	ElemType *FromHandle(Handle handle) const {
+		if (handle == InvalidHandle) {
+			return nullptr;
+		}
+
+		assert(handle < Capacity && "Handle out of the pool range.");
+		return &elems[handle];
+	}
+
+	static constexpr size_t NeededSizeInBytes = ElemsOffset + sizeof(ElemType) * Capacity;
+
+private:
+	void setPointers(void *preAllocatedData) {
+		header = static_cast<Header*>(preAllocatedData);
+		elems = reinterpret_cast<ElemType*>(static_cast<unsigned char*>(preAllocatedData) + ElemsOffset);
+	}
+
+	bool isHeaderValid() const {
+		return header->magic.load(std::memory_order_acquire) == SLMEM_SHARED_POOL_MAGIC
+			&& header->version == SLMEM_SHARED_POOL_VERSION
+			&& header->elemSize == sizeof(ElemType)
+			&& header->capacity == Capacity;
+	}
+
+	FreelistNode *nodeAt(size_t poolIndex) const {
+		return reinterpret_cast<FreelistNode*>(&elems[poolIndex]);
+	}
+
+	Header *header = nullptr;
+	ElemType *elems = nullptr;
+
+	void *mappedData = nullptr;
+};
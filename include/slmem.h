@@ -2,4 +2,8 @@
 
 #include "allocator.h"
 #include "alloc_debug.h"
-
+#include "alloc_hardening.h"
+#include "alloc_reclaim.h"
+#include "arena_layout.h"
+#include "pool_persistent.h"
+#include "pool_shared.h"
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdlib.h>
+
+
+// Hardening corruption handler for the tests, counts the reports instead of aborting
+class CountCorruptionHandler {
+public:
+	static void OnCorruption(const char * /*what*/, const void * /*addr*/) {
+		Count()++;
+	}
+
+	static size_t &Count() {
+		static size_t count = 0;
+		return count;
+	}
+};
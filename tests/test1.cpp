@@ -0,0 +1,75 @@
+#include "slmem.h"
+
+typedef DefaultLeakDetectPolicy<1024> MyLeakDetectPolicy;
+typedef DefaultAllocTagPolicy<1024> MyAllocTagPolicy;
+
+struct Particle {
+	float pos[3];
+	float vel[3];
+};
+
+static constexpr size_t PoolCapacity = 37;
+static constexpr size_t WorkBufferSize = 128;
+
+typedef PoolAllocatorFreelist<Particle, PoolCapacity, MyAllocTagPolicy, MyLeakDetectPolicy> ParticlePool;
+typedef PoolAllocatorBitArray<char, PoolCapacity, MyAllocTagPolicy, MyLeakDetectPolicy> CharPool;
+typedef LinearAllocator<8> WorkBuffer;
+
+typedef CacheAlignedArenaLayout<MyLeakDetectPolicy, MyAllocTagPolicy, ParticlePool, CharPool, ArenaSized<WorkBuffer, WorkBufferSize>> TestArena;
+
+static_assert(TestArena::Count == 5, "Unexpected arena slot count.");
+static_assert(TestArena::OffsetOf<0>() == 0, "First slot must start at the beginning of the arena.");
+static_assert(TestArena::SizeOf<2>() == ParticlePool::NeededSizeInBytes, "Slot size doesn't match the allocator needed size.");
+static_assert(TestArena::SizeOf<4>() == WorkBufferSize, "Sized slot doesn't use the given size.");
+static_assert(TestArena::NeededSizeInBytes % SLMEM_CACHE_LINE_SIZE == 0, "Arena size must be padded to the alignment.");
+static_assert(ArenaSlotTraits<ParticlePool>::NeededAlignment == alignof(Particle), "Pool slots must need their element alignment.");
+static_assert(ArenaSlotTraits<ArenaSized<WorkBuffer, WorkBufferSize>>::NeededAlignment == 1, "Slots without elements need no alignment.");
+
+alignas(TestArena::NeededAlignment) static char arena[TestArena::NeededSizeInBytes];
+
+
+template<size_t Index>
+static void checkSlot() {
+	static_assert(TestArena::OffsetOf<Index>() % SLMEM_CACHE_LINE_SIZE == 0, "Slot isn't aligned on a cache line.");
+	static_assert(TestArena::OffsetOf<Index>() + TestArena::SizeOf<Index>() <= TestArena::OffsetOf<Index + 1>(), "Slots overlap.");
+}
+
+int main(int argc, char *argv[]) {
+	checkSlot<0>();
+	checkSlot<1>();
+	checkSlot<2>();
+	checkSlot<3>();
+	static_assert(TestArena::OffsetOf<4>() + TestArena::SizeOf<4>() <= TestArena::NeededSizeInBytes, "Last slot overflows the arena.");
+
+	ParticlePool particles;
+	CharPool chars;
+	WorkBuffer workBuffer;
+
+	TestArena::SetData(arena, sizeof(arena), MyLeakDetectPolicy(), MyAllocTagPolicy(), particles, chars, workBuffer);
+
+	assert(particles.HasData() && chars.HasData() && workBuffer.HasData());
+
+	Particle *p = particles.Get("particle");
+	assert((void*)p == TestArena::GetData<2>(arena));
+	p->pos[0] = 1.0f;
+
+	char *c = chars.Get("char");
+	assert((void*)c == TestArena::GetData<3>(arena));
+	*c = 'c';
+
+	void *work = workBuffer.Alloc(WorkBufferSize);
+	assert(work == TestArena::GetData<4>(arena));
+	assert(workBuffer.Alloc(1) == nullptr);
+
+	size_t numAllocs = 0;
+	MyLeakDetectPolicy::EnumerateRemainingAllocs([&numAllocs](const MyLeakDetectPolicy::LeakInfo &) { numAllocs++; });
+	assert(numAllocs == 2);
+
+	particles.Return(p);
+	chars.Return(c);
+
+	assert(particles.GetCount() == 0);
+	assert(chars.GetCount() == 0);
+
+	return 0;
+}
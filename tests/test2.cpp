@@ -0,0 +1,170 @@
+#include "slmem.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct Order {
+	uint64_t id;
+	uint32_t quantity;
+	uint32_t next;	// pool offset of the next order in the same book
+};
+
+static constexpr size_t PoolCapacity = 1000;
+typedef PoolAllocatorPersistent<Order, PoolCapacity> OrderPool;
+typedef PoolAllocatorPersistent<Order, PoolCapacity / 2> SmallerOrderPool;
+typedef PoolAllocatorPersistent<Order, 10> TinyOrderPool;
+
+static const char *poolPath = "slmem_test2_pool.bin";
+
+alignas(64) static unsigned char relocatedData[OrderPool::NeededSizeInBytes];
+
+
+int main(int argc, char *argv[]) {
+	unlink(poolPath);
+
+	{
+		OrderPool pool;
+		const bool opened = pool.Open(poolPath);
+		assert(opened);
+		assert(!pool.WasRestored());
+		assert(pool.GetCount() == 0);
+
+		Order *prev = nullptr;
+		for (uint64_t i = 0; i < 3; i++) {
+			Order *order = pool.Get();
+			order->id = 100 + i;
+			order->quantity = uint32_t(i * 10);
+			order->next = pool.ToOffset(prev);
+			prev = order;
+		}
+
+		Order *returned = pool.Get();
+		returned->id = 666;
+		pool.Return(returned);
+
+		const bool flushed = pool.Flush();
+		assert(flushed);
+	}
+
+	{
+		OrderPool pool;
+		const bool opened = pool.Open(poolPath);
+		assert(opened);
+		assert(pool.WasRestored());
+		assert(pool.GetCount() == 3);
+
+		size_t liveCount = 0;
+		uint64_t idSum = 0;
+		pool.EnumerateLive([&](const Order &order) {
+			liveCount++;
+			idSum += order.id;
+		});
+		assert(liveCount == 3);
+		assert(idSum == 100 + 101 + 102);
+
+		// follow the offset links starting from the last allocated order
+		Order *head = nullptr;
+		pool.EnumerateLive([&](Order &order) {
+			if (order.id == 102) {
+				head = &order;
+			}
+		});
+		assert(head);
+
+		size_t chainLength = 0;
+		for (Order *order = head; order; order = pool.FromOffset(order->next)) {
+			assert(pool.IsLive(order));
+			assert(order->id == 102 - chainLength);
+			chainLength++;
+		}
+		assert(chainLength == 3);
+	}
+
+	{
+		// the pool is relocatable, re-attach to a copy of the file content at another address
+		FILE *file = fopen(poolPath, "rb");
+		assert(file);
+		const size_t readSize = fread(relocatedData, 1, OrderPool::NeededSizeInBytes, file);
+		assert(readSize == OrderPool::NeededSizeInBytes);
+		fclose(file);
+
+		OrderPool pool(relocatedData, OrderPool::NeededSizeInBytes);
+		assert(pool.WasRestored());
+		assert(pool.GetCount() == 3);
+
+		for (size_t i = 3; i < PoolCapacity; i++) {
+			Order *order = pool.Get();
+			assert(order);
+			order->id = i;
+		}
+		assert(pool.Get() == nullptr);
+		assert(pool.GetCount() == PoolCapacity);
+	}
+
+	{
+		// a pool with another layout must neither re-attach to the file nor overwrite it
+		SmallerOrderPool pool;
+		const bool opened = pool.Open(poolPath);
+		assert(!opened);
+		assert(!pool.HasData());
+
+		OrderPool original;
+		const bool reopened = original.Open(poolPath);
+		assert(reopened);
+		assert(original.WasRestored());
+		assert(original.GetCount() == 3);
+	}
+
+	{
+		// a process dying between a change and the next Flush leaves a pool that isn't trusted anymore
+		const pid_t pid = fork();
+		assert(pid != -1);
+		if (pid == 0) {
+			OrderPool pool;
+			if (!pool.Open(poolPath) || !pool.Get()) {
+				_exit(1);
+			}
+			_exit(0);
+		}
+
+		int status = 0;
+		waitpid(pid, &status, 0);
+		assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+		OrderPool pool;
+		const bool opened = pool.Open(poolPath);
+		assert(!opened);
+
+		const bool discarded = pool.Open(poolPath, true);
+		assert(discarded);
+		assert(!pool.WasRestored());
+		assert(pool.GetCount() == 0);
+	}
+
+	{
+		// a file left by a smaller pool is too short to be mapped as is, discarding it grows it
+		unlink(poolPath);
+		{
+			TinyOrderPool tinyPool;
+			const bool opened = tinyPool.Open(poolPath);
+			assert(opened);
+			assert(tinyPool.Get());
+		}
+
+		OrderPool pool;
+		const bool opened = pool.Open(poolPath);
+		assert(!opened);
+
+		const bool discarded = pool.Open(poolPath, true);
+		assert(discarded);
+		assert(!pool.WasRestored());
+		assert(pool.GetCount() == 0);
+
+		for (size_t i = 0; i < PoolCapacity; i++) {
+			assert(pool.Get());
+		}
+	}
+
+	unlink(poolPath);
+
+	return 0;
+}
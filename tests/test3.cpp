@@ -0,0 +1,134 @@
+#include "slmem.h"
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct Record {
+	uint32_t producer;
+	uint32_t sequence;
+	uint64_t payload[6];
+	uint64_t checksum;
+};
+
+static constexpr size_t PoolCapacity = 64;
+static constexpr int ProducerCount = 4;
+static constexpr uint32_t RecordsPerProducer = 20000;
+
+typedef PoolAllocatorShared<Record, PoolCapacity> RecordPool;
+
+
+static uint64_t computeChecksum(const Record &record) {
+	uint64_t checksum = (uint64_t(record.producer) << 32) | record.sequence;
+	for (size_t i = 0; i < sizeof(record.payload) / sizeof(record.payload[0]); i++) {
+		checksum = checksum * 31 + record.payload[i];
+	}
+	return checksum;
+}
+
+// Each producer attaches to the pool on its own, fills records and sends their handle to the consumer.
+// Some records are returned by the producer itself to also stress concurrent Get/Return.
+static int runProducer(const char *poolName, uint32_t producer, int handleFd) {
+	RecordPool pool;
+	if (!pool.Open(poolName)) {
+		return 1;
+	}
+
+	for (uint32_t sequence = 0; sequence < RecordsPerProducer; sequence++) {
+		Record *record = nullptr;
+		while (!(record = pool.Get())) {
+			sched_yield();
+		}
+
+		record->producer = producer;
+		record->sequence = sequence;
+		for (size_t i = 0; i < sizeof(record->payload) / sizeof(record->payload[0]); i++) {
+			record->payload[i] = sequence * 7 + i + producer;
+		}
+		record->checksum = computeChecksum(*record);
+
+		if (sequence % 4 == 3) {
+			pool.Return(record);
+			continue;
+		}
+
+		const RecordPool::Handle handle = pool.ToHandle(record);
+		if (write(handleFd, &handle, sizeof(handle)) != sizeof(handle)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	char poolName[64];
+	snprintf(poolName, sizeof(poolName), "/slmem_test3_%d", int(getpid()));
+
+	RecordPool pool;
+	const bool created = pool.Create(poolName);
+	assert(created);
+
+	int handlePipe[2];
+	const int pipeRes = pipe(handlePipe);
+	assert(pipeRes == 0);
+
+	pid_t producers[ProducerCount];
+	for (int i = 0; i < ProducerCount; i++) {
+		producers[i] = fork();
+		assert(producers[i] != -1);
+
+		if (producers[i] == 0) {
+			close(handlePipe[0]);
+			_exit(runProducer(poolName, uint32_t(i), handlePipe[1]));
+		}
+	}
+	close(handlePipe[1]);
+
+	uint32_t nextSequence[ProducerCount] = {};
+	size_t received = 0;
+
+	RecordPool::Handle handle;
+	while (read(handlePipe[0], &handle, sizeof(handle)) == sizeof(handle)) {
+		Record *record = pool.FromHandle(handle);
+		assert(record);
+		assert(record->producer < ProducerCount);
+		assert(record->checksum == computeChecksum(*record));
+
+		// records of a producer are received in order, minus the ones it returned itself
+		assert(record->sequence >= nextSequence[record->producer]);
+		nextSequence[record->producer] = record->sequence + 1;
+
+		pool.Return(record);
+		received++;
+	}
+	close(handlePipe[0]);
+
+	for (int i = 0; i < ProducerCount; i++) {
+		int status = 0;
+		waitpid(producers[i], &status, 0);
+		assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+
+	assert(received == ProducerCount * (RecordsPerProducer - RecordsPerProducer / 4));
+	assert(pool.GetCount() == 0);
+
+	// every slot must be back in the freelist exactly once
+	Record *records[PoolCapacity];
+	for (size_t i = 0; i < PoolCapacity; i++) {
+		records[i] = pool.Get();
+		assert(records[i]);
+		for (size_t j = 0; j < i; j++) {
+			assert(records[j] != records[i]);
+		}
+	}
+	assert(pool.Get() == nullptr);
+
+	pool.Close();
+	RecordPool::Unlink(poolName);
+
+	RecordPool detached;
+	const bool reopened = detached.Open(poolName);
+	assert(!reopened);
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include "slmem.h"
+#include "count_corruption_handler.h"
+
+typedef DefaultHardeningPolicy<CountCorruptionHandler> TestHardeningPolicy;
+
+struct Message {
+	uint64_t id;
+	uint64_t flags;
+	char text[48];
+};
+
+static constexpr size_t PoolCapacity = 16;
+typedef PoolAllocatorFreelist<Message, PoolCapacity, NoAllocTagPolicy, NoLeakDetectPolicy, NoFallbackPolicy, TestHardeningPolicy> HardenedListPool;
+typedef PoolAllocatorBitArray<Message, PoolCapacity, NoAllocTagPolicy, NoLeakDetectPolicy, NoFallbackPolicy, TestHardeningPolicy> HardenedBitPool;
+typedef LinearAllocator<8, NoAllocTagPolicy, NoLeakDetectPolicy, NoFallbackPolicy, TestHardeningPolicy> HardenedLinear;
+
+Message listPoolData[PoolCapacity];
+Message bitPoolData[PoolCapacity];
+alignas(8) unsigned char linearData[256];
+
+
+int main(int argc, char *argv[]) {
+	HardenedListPool listPool(listPoolData, sizeof(listPoolData));
+	HardenedBitPool bitPool(bitPoolData, sizeof(bitPoolData));
+
+	// regular use doesn't trigger anything
+	Message *messages[PoolCapacity];
+	for (size_t i = 0; i < PoolCapacity; i++) {
+		messages[i] = listPool.Get();
+		assert(messages[i]);
+		memset(messages[i], 0, sizeof(Message));
+	}
+	for (size_t i = 0; i < PoolCapacity; i++) {
+		listPool.Return(messages[i]);
+	}
+	assert(CountCorruptionHandler::Count() == 0);
+	assert(listPool.GetCount() == 0);
+
+#if !defined(SLMEM_ASAN_ENABLED)
+	// returned slots are poisoned past the freelist link and canary
+	const unsigned char *poisoned = reinterpret_cast<const unsigned char*>(messages[0]->text);
+	for (size_t i = 0; i < sizeof(messages[0]->text); i++) {
+		assert(poisoned[i] == SLMEM_HARDENING_POISON_BYTE);
+	}
+#endif // #if !defined(SLMEM_ASAN_ENABLED)
+
+	// double return is reported and leaves the freelist intact
+	Message *msg = listPool.Get();
+	listPool.Return(msg);
+	listPool.Return(msg);
+	assert(CountCorruptionHandler::Count() == 1);
+	assert(listPool.GetCount() == 0);
+
+	Message *first = listPool.Get();
+	Message *second = listPool.Get();
+	assert(first != second);
+	assert(CountCorruptionHandler::Count() == 1);
+
+	// writing into a returned element is caught by the canary on the next Get
+	listPool.Return(second);
+	second->flags = 42;
+	Message *reused = listPool.Get();
+	assert(reused == second);
+	assert(CountCorruptionHandler::Count() == 2);
+
+	// a corrupted freelist link is never followed
+	listPool.Return(reused);
+	reused->id = 0x1234;
+	Message *afterCorruptedLink = listPool.Get();
+	assert(afterCorruptedLink == reused);
+	assert(CountCorruptionHandler::Count() == 3);
+	listPool.Return(first);
+
+	// bit array pool: double return and use after return
+	Message *bitMsg = bitPool.Get();
+	bitPool.Return(bitMsg);
+	bitPool.Return(bitMsg);
+	assert(CountCorruptionHandler::Count() == 4);
+	assert(bitPool.GetCount() == 0);
+
+	bitMsg->id = 7;
+	Message *bitReused = bitPool.Get();
+	assert(bitReused == bitMsg);
+	assert(CountCorruptionHandler::Count() == 5);
+	bitPool.Return(bitReused);
+
+	// linear allocator guards
+	HardenedLinear linear(linearData, sizeof(linearData));
+	char *str = static_cast<char*>(linear.Alloc(5));
+	memcpy(str, "abcd", 5);
+	uint64_t *values = static_cast<uint64_t*>(linear.Alloc(2 * sizeof(uint64_t)));
+	values[0] = values[1] = 0;
+	assert(linear.CheckGuards());
+	assert(CountCorruptionHandler::Count() == 5);
+
+#if !defined(SLMEM_ASAN_ENABLED)
+	// off by one within the alignment padding
+	str[5] = 'e';
+	assert(!linear.CheckGuards());
+	assert(CountCorruptionHandler::Count() == 6);
+	str[5] = static_cast<char>(SLMEM_HARDENING_POISON_BYTE);
+	assert(linear.CheckGuards());
+
+	// overflow into the guard, reported on Reset
+	memset(values, 0, 3 * sizeof(uint64_t));
+	linear.Reset();
+	assert(CountCorruptionHandler::Count() == 7);
+#else
+	linear.Reset();
+#endif // #if !defined(SLMEM_ASAN_ENABLED)
+
+	assert(linear.Alloc(sizeof(linearData) - TestHardeningPolicy::LinearGuardSize));
+	assert(linear.Alloc(1) == nullptr);
+	assert(linear.CheckGuards());
+
+	// the no-op policy doesn't reserve anything
+	unsigned char plainData[8];
+	LinearAllocator<1> plain(plainData, sizeof(plainData));
+	assert(plain.Alloc(sizeof(plainData)));
+
+	return 0;
+}
@@ -0,0 +1,185 @@
+#include "slmem.h"
+#include <string>
+
+static int liveWidgets = 0;
+static int copies = 0;
+
+struct Widget {
+	Widget(int id, std::string name) : id(id), name(std::move(name)) {
+		liveWidgets++;
+	}
+
+	Widget(const Widget &other) : id(other.id), name(other.name) {
+		liveWidgets++;
+		copies++;
+	}
+
+	~Widget() {
+		liveWidgets--;
+	}
+
+	int id;
+	std::string name;
+};
+
+struct Vec3 {
+	Vec3(float v = 0.0f) : x(v), y(v), z(v) {}
+
+	float x, y, z;
+};
+
+// Remembers the id of the last tagged allocation
+class LastTagPolicy {
+public:
+	static void Tag(const void * /*addr*/, const char *id, size_t /*size*/) {
+		LastId() = id;
+	}
+
+	static void Untag(const void * /*addr*/) {}
+
+	static const char *&LastId() {
+		static const char *id = nullptr;
+		return id;
+	}
+};
+
+static const char *const widgetAllocId = SL_CURRENT_FILE_LINENUM;
+
+static constexpr size_t PoolCapacity = 4;
+typedef PoolAllocatorFreelist<Widget, PoolCapacity> WidgetListPool;
+typedef PoolAllocatorBitArray<Widget, PoolCapacity> WidgetBitPool;
+typedef PoolAllocatorFreelist<Widget, PoolCapacity, LastTagPolicy> TaggedWidgetListPool;
+typedef PoolAllocatorBitArray<Widget, PoolCapacity, LastTagPolicy> TaggedWidgetBitPool;
+
+alignas(Widget) static unsigned char staticPoolData[WidgetListPool::NeededSizeInBytes];
+WidgetListPool staticPool(staticPoolData, sizeof(staticPoolData));
+
+typedef PoolPtr<WidgetListPool, staticPool> WidgetPtr;
+static_assert(sizeof(WidgetPtr) == sizeof(Widget*), "Statically bound pool pointers must be the size of a raw pointer.");
+
+
+template<typename PoolType>
+static void testEmplace(PoolType &pool) {
+	const std::string name = "a rather long widget name, no small string optimization";
+
+	Widget *widget = pool.Emplace(1, name);
+	assert(widget);
+	assert(widget->id == 1 && widget->name == name);
+	assert(liveWidgets == 1 && copies == 0);
+	assert(pool.GetCount() == 1);
+
+	pool.Destroy(widget);
+	assert(liveWidgets == 0);
+	assert(pool.GetCount() == 0);
+
+	{
+		typename PoolType::UniquePtr owned = pool.MakeUnique(2, "owned");
+		assert(owned && owned->id == 2);
+		assert(pool.GetCount() == 1);
+
+		typename PoolType::UniquePtr moved = std::move(owned);
+		assert(!owned && moved);
+		assert(pool.GetCount() == 1);
+	}
+	assert(liveWidgets == 0);
+	assert(pool.GetCount() == 0);
+
+	// full pool
+	Widget *widgets[PoolCapacity];
+	for (size_t i = 0; i < PoolCapacity; i++) {
+		widgets[i] = pool.Emplace(int(i), "full");
+	}
+	assert(!pool.Emplace(-1, "none"));
+	assert(!pool.MakeUnique(-1, "none"));
+	for (size_t i = 0; i < PoolCapacity; i++) {
+		pool.Destroy(widgets[i]);
+	}
+	assert(liveWidgets == 0 && copies == 0);
+}
+
+template<typename PoolType>
+static void testAllocId(PoolType &pool) {
+	LastTagPolicy::LastId() = nullptr;
+	Widget *widget = pool.Emplace(AllocId(widgetAllocId), 5, "tagged");
+	assert(widget && widget->id == 5);
+	assert(LastTagPolicy::LastId() == widgetAllocId);
+	pool.Destroy(widget);
+
+	// the id isn't mistaken for a constructor arg, nor is a constructor arg mistaken for an id
+	const AllocId allocId(widgetAllocId);
+	LastTagPolicy::LastId() = nullptr;
+	{
+		typename PoolType::UniquePtr owned = pool.MakeUnique(allocId, 6, "owned");
+		assert(owned && owned->id == 6 && owned->name == "owned");
+		assert(LastTagPolicy::LastId() == widgetAllocId);
+	}
+
+	widget = pool.Emplace(7, "untagged");
+	assert(strcmp(LastTagPolicy::LastId(), SLMEM_NOALLOC_TAG_POLICY_INVALID_ID) == 0);
+	pool.Destroy(widget);
+
+	assert(pool.GetCount() == 0);
+	assert(liveWidgets == 0);
+}
+
+int main(int argc, char *argv[]) {
+	alignas(Widget) unsigned char listPoolData[WidgetListPool::NeededSizeInBytes];
+	alignas(Widget) unsigned char bitPoolData[WidgetBitPool::NeededSizeInBytes];
+
+	WidgetListPool listPool(listPoolData, sizeof(listPoolData));
+	WidgetBitPool bitPool(bitPoolData, sizeof(bitPoolData));
+
+	testEmplace(listPool);
+	testEmplace(bitPool);
+
+	{
+		alignas(Widget) unsigned char taggedListPoolData[TaggedWidgetListPool::NeededSizeInBytes];
+		alignas(Widget) unsigned char taggedBitPoolData[TaggedWidgetBitPool::NeededSizeInBytes];
+
+		TaggedWidgetListPool taggedListPool(taggedListPoolData, sizeof(taggedListPoolData));
+		TaggedWidgetBitPool taggedBitPool(taggedBitPoolData, sizeof(taggedBitPoolData));
+
+		testAllocId(taggedListPool);
+		testAllocId(taggedBitPool);
+	}
+
+	{
+		WidgetPtr widget = MakePoolPtr<WidgetListPool, staticPool>(AllocId(widgetAllocId), 3, "static");
+		assert(widget->id == 3);
+		assert(staticPool.GetCount() == 1);
+	}
+	assert(staticPool.GetCount() == 0);
+	assert(liveWidgets == 0);
+
+	// linear allocator placement and array variants
+	alignas(8) unsigned char linearData[256];
+	LinearAllocator<8> linear(linearData, sizeof(linearData));
+
+	Vec3 *one = linear.Emplace<Vec3>(1.0f);
+	assert(one && one->x == 1.0f && one->z == 1.0f);
+
+	Vec3 *many = linear.EmplaceArray<Vec3>(8, 2.0f);
+	assert(many);
+	for (size_t i = 0; i < 8; i++) {
+		assert(many[i].x == 2.0f && many[i].y == 2.0f && many[i].z == 2.0f);
+	}
+
+	assert(linear.EmplaceArray<Vec3>(100) == nullptr);
+	assert(linear.EmplaceArray<Vec3>(SIZE_MAX / sizeof(Vec3) + 2) == nullptr);
+
+	{
+		alignas(8) unsigned char taggedLinearData[128];
+		LinearAllocator<8, LastTagPolicy> taggedLinear(taggedLinearData, sizeof(taggedLinearData));
+
+		LastTagPolicy::LastId() = nullptr;
+		assert(taggedLinear.Emplace<Vec3>(AllocId(widgetAllocId), 3.0f));
+		assert(LastTagPolicy::LastId() == widgetAllocId);
+
+		LastTagPolicy::LastId() = nullptr;
+		Vec3 *tagged = taggedLinear.EmplaceArray<Vec3>(AllocId(widgetAllocId), 2, 4.0f);
+		assert(tagged && tagged[1].x == 4.0f);
+		assert(LastTagPolicy::LastId() == widgetAllocId);
+	}
+
+	return 0;
+}
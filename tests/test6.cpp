@@ -0,0 +1,189 @@
+#include "slmem.h"
+#include "count_corruption_handler.h"
+
+typedef DefaultHardeningPolicy<CountCorruptionHandler> TestHardeningPolicy;
+
+struct Session {
+	uint64_t id;
+	uint64_t flags;
+	char payload[496];
+};
+
+static constexpr size_t PageSizeForTests = 4096;
+static constexpr size_t PoolCapacity = 256;
+
+typedef PoolAllocatorBitArray<Session, PoolCapacity> SessionBitPool;
+typedef PoolAllocatorFreelist<Session, PoolCapacity> SessionListPool;
+typedef PoolAllocatorBitArray<Session, PoolCapacity, NoAllocTagPolicy, NoLeakDetectPolicy, NoFallbackPolicy, TestHardeningPolicy> HardenedBitPool;
+typedef PoolAllocatorFreelist<Session, PoolCapacity, NoAllocTagPolicy, NoLeakDetectPolicy, NoFallbackPolicy, TestHardeningPolicy> HardenedListPool;
+
+alignas(PageSizeForTests) static unsigned char bitPoolData[SessionBitPool::NeededSizeInBytes];
+alignas(PageSizeForTests) static unsigned char listPoolData[SessionListPool::NeededSizeInBytes];
+alignas(PageSizeForTests) static unsigned char linearData[64 * PageSizeForTests];
+
+
+// Fills the whole pool, keeps the elements listed in keep and returns all the others
+template<typename PoolType>
+static void fillAndKeep(PoolType &pool, Session *(&sessions)[PoolCapacity], const size_t *keep, size_t keepCount) {
+	for (size_t i = 0; i < PoolCapacity; i++) {
+		sessions[i] = pool.Get();
+		assert(sessions[i]);
+		memset(sessions[i], 0xAB, sizeof(Session));
+		sessions[i]->id = i;
+	}
+
+	for (size_t i = 0; i < PoolCapacity; i++) {
+		bool kept = false;
+		for (size_t k = 0; k < keepCount; k++) {
+			kept |= sessions[i]->id == keep[k];
+		}
+
+		if (!kept) {
+			pool.Return(sessions[i]);
+			sessions[i] = nullptr;
+		}
+	}
+}
+
+template<typename PoolType>
+static void refillAndCheck(PoolType &pool, Session *(&sessions)[PoolCapacity], const size_t *keep, size_t keepCount) {
+	for (size_t k = 0; k < keepCount; k++) {
+		Session *kept = sessions[keep[k]];
+		assert(kept && kept->id == keep[k] && kept->flags == 0xABABABABABABABABull);
+	}
+
+	while (pool.GetCount() < PoolCapacity) {
+		Session *session = pool.Get();
+		assert(session);
+		memset(session, 0, sizeof(Session));
+	}
+	assert(pool.Get() == nullptr);
+}
+
+int main(int argc, char *argv[]) {
+	const size_t pageSize = VirtualMemory::PageSize();
+	if (pageSize != PageSizeForTests) {
+		printf("Skipping, page size is %zu\n", pageSize);
+		return 0;
+	}
+
+	Session *sessions[PoolCapacity];
+
+	// bit array pool: any page made of free slots is released, 8 slots per page
+	{
+		SessionBitPool pool(bitPoolData, sizeof(bitPoolData));
+		const size_t keep[] = { 0, 100, 255 };
+		fillAndKeep(pool, sessions, keep, 3);
+
+		const size_t released = pool.Reclaim<VirtualMemory>();
+		assert(released == sizeof(bitPoolData) - 3 * pageSize);
+		assert(pool.Reclaim<VirtualMemory>() == 0);
+
+		refillAndCheck(pool, sessions, keep, 3);
+	}
+
+	// freelist pool: the pages past the last slot in use are released
+	{
+		SessionListPool pool(listPoolData, sizeof(listPoolData));
+		const size_t keep[] = { 3, 20, 60 };
+		fillAndKeep(pool, sessions, keep, 3);
+
+		const size_t released = pool.Reclaim<VirtualMemory>();
+		assert(released == sizeof(listPoolData) - 8 * pageSize);
+		assert(pool.Reclaim<VirtualMemory>() == 0);
+		assert(pool.GetCount() == 3);
+
+		refillAndCheck(pool, sessions, keep, 3);
+	}
+
+	// hardened pools, released slots lost their canary but must not be reported
+	{
+		HardenedBitPool bitPool(bitPoolData, sizeof(bitPoolData));
+		HardenedListPool listPool(listPoolData, sizeof(listPoolData));
+		const size_t keep[] = { 1, 2 };
+
+		fillAndKeep(bitPool, sessions, keep, 2);
+		assert(bitPool.Reclaim<VirtualMemory>() > 0);
+		refillAndCheck(bitPool, sessions, keep, 2);
+
+		fillAndKeep(listPool, sessions, keep, 2);
+		assert(listPool.Reclaim<VirtualMemory>() > 0);
+		refillAndCheck(listPool, sessions, keep, 2);
+
+		assert(CountCorruptionHandler::Count() == 0);
+	}
+
+	// hardened freelist, slots dropped by Reclaim on a page still in use are handed out again and returned normally
+	{
+		HardenedListPool listPool(listPoolData, sizeof(listPoolData));
+		for (size_t i = 0; i < PoolCapacity; i++) {
+			sessions[i] = listPool.Get();
+			assert(sessions[i]);
+		}
+
+		for (size_t i = PoolCapacity - 3; i < PoolCapacity; i++) {
+			listPool.Return(sessions[i]);
+		}
+
+		assert(listPool.Reclaim<VirtualMemory>() == 0);
+
+		Session *session = listPool.Get();
+		assert(session == sessions[PoolCapacity - 3]);
+		listPool.Return(session);
+
+		assert(listPool.GetCount() == PoolCapacity - 3);
+		assert(CountCorruptionHandler::Count() == 0);
+	}
+
+	// linear allocator, after a Reset
+	{
+		LinearAllocator<16> linear(linearData, sizeof(linearData));
+		void *small = linear.Alloc(100);
+		memset(small, 1, 100);
+		linear.Reset();
+
+		void *big = linear.Alloc(sizeof(linearData) / 2);
+		memset(big, 1, sizeof(linearData) / 2);
+		linear.Reset();
+
+		void *kept = linear.Alloc(100);
+		memset(kept, 2, 100);
+
+		assert(linear.Reclaim<VirtualMemory>() == sizeof(linearData) / 2 - pageSize);
+		assert(linear.Reclaim<VirtualMemory>() == 0);
+		assert(*static_cast<unsigned char*>(kept) == 2);
+	}
+
+	// idle driven reclaim
+	{
+		SessionBitPool pool(bitPoolData, sizeof(bitPoolData));
+		IdleReclaimer<SessionBitPool> reclaimer(pool, 10);
+
+		const size_t keep[] = { 0 };
+		fillAndKeep(pool, sessions, keep, 1);
+
+		// a pool in use isn't idle, even when its count is the same at every update
+		for (uint64_t now = 0; now < 20; now++) {
+			pool.Return(pool.Get());
+			assert(reclaimer.Update(now) == 0);
+		}
+
+		assert(reclaimer.Update(28) == 0);
+
+		const size_t released = reclaimer.Update(29);
+		assert(released == sizeof(bitPoolData) - pageSize);
+		assert(reclaimer.Update(40) == 0);
+
+		// activity restarts the idle period
+		Session *session = pool.Get();
+		assert(reclaimer.Update(41) == 0);
+		assert(reclaimer.Update(50) == 0);
+		pool.Return(session);
+		assert(reclaimer.Update(51) == 0);
+		assert(reclaimer.Update(61) == 0);
+
+		assert(reclaimer.GetReleasedSize() == released);
+	}
+
+	return 0;
+}